@@ -0,0 +1,246 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include "ParticleEngine.h"
+#include "BenchmarkScenes.h"
+#include "Config.hpp"
+#include "SimdSupport.h"
+
+//Sweeps every benchmark scene over a range of particle counts and writes the cost of each Update phase
+//in nanoseconds per particle per step. The output format follows the file extension, .csv or .json.
+//Usage: Benchmark [--out file] [--steps n] [--warmup n] [--dt seconds] [--seed n] [--scene name] [--max-particles n]
+namespace
+{
+	struct Options
+	{
+		std::string out = "benchmark.json";
+		size_t steps = 200u;
+		size_t warmup = 20u;
+		float deltaTime = Config::fixedPhysicsUpdate;
+		uint64_t seed = 1u;
+		std::string scene;
+		size_t maxParticles = 1000000u;
+	};
+
+	struct Result
+	{
+		std::string scene;
+		size_t particleCount;
+		double averageParticles;
+		size_t balls;
+		size_t clothNodes;
+		size_t workers;
+		ParticleEngine::PhaseTimings perParticle;
+		double msPerStep;
+	};
+
+	const size_t particleCounts[] = { 10000u, 30000u, 100000u, 300000u, 1000000u };
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const bool hasValue = i + 1 < argc;
+
+			if (!std::strcmp(argv[i], "--out") && hasValue)
+			{
+				options.out = argv[++i];
+			}
+			else if (!std::strcmp(argv[i], "--steps") && hasValue)
+			{
+				options.steps = std::strtoul(argv[++i], nullptr, 10);
+			}
+			else if (!std::strcmp(argv[i], "--warmup") && hasValue)
+			{
+				options.warmup = std::strtoul(argv[++i], nullptr, 10);
+			}
+			else if (!std::strcmp(argv[i], "--dt") && hasValue)
+			{
+				options.deltaTime = static_cast<float>(std::atof(argv[++i]));
+			}
+			else if (!std::strcmp(argv[i], "--seed") && hasValue)
+			{
+				options.seed = std::strtoull(argv[++i], nullptr, 10);
+			}
+			else if (!std::strcmp(argv[i], "--scene") && hasValue)
+			{
+				options.scene = argv[++i];
+			}
+			else if (!std::strcmp(argv[i], "--max-particles") && hasValue)
+			{
+				options.maxParticles = std::strtoul(argv[++i], nullptr, 10);
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		return options.steps > 0u && options.deltaTime > 0.0f;
+	}
+
+	Result Run(const BenchmarkScenes::Scene& scene, size_t particleCount, const Options& options)
+	{
+		//The engine owns worker threads and large arrays, keep it off the stack
+		std::unique_ptr<ParticleEngine> engine(new ParticleEngine(particleCount, scene.ballCapacity));
+		scene.build(*engine, particleCount, options.seed);
+
+		for (size_t i = 0u; i < options.warmup; ++i)
+		{
+			engine->Update(options.deltaTime);
+		}
+
+		ParticleEngine::PhaseTimings total;
+		double particleSteps = 0.0;
+
+		for (size_t i = 0u; i < options.steps; ++i)
+		{
+			//Cost is charged to the particles alive when the step starts
+			particleSteps += static_cast<double>(engine->GetParticles().Size());
+			engine->Update(options.deltaTime);
+
+			const ParticleEngine::PhaseTimings& step = engine->GetPhaseTimings();
+			total.emitters += step.emitters;
+			total.integrateBodies += step.integrateBodies;
+			total.solveCloth += step.solveCloth;
+			total.particlePipeline += step.particlePipeline;
+			total.checkCollisions += step.checkCollisions;
+			total.resolveCollisions += step.resolveCollisions;
+			total.deleteParticles += step.deleteParticles;
+			total.updateSleep += step.updateSleep;
+		}
+
+		const double divisor = particleSteps > 0.0 ? particleSteps : 1.0;
+
+		Result result;
+		result.scene = scene.name;
+		result.particleCount = particleCount;
+		result.averageParticles = particleSteps / static_cast<double>(options.steps);
+		result.balls = engine->GetBalls().size();
+		result.clothNodes = engine->GetCloth().size();
+		result.workers = engine->GetWorkerCount();
+		result.perParticle.emitters = total.emitters / divisor;
+		result.perParticle.integrateBodies = total.integrateBodies / divisor;
+		result.perParticle.solveCloth = total.solveCloth / divisor;
+		result.perParticle.particlePipeline = total.particlePipeline / divisor;
+		result.perParticle.checkCollisions = total.checkCollisions / divisor;
+		result.perParticle.resolveCollisions = total.resolveCollisions / divisor;
+		result.perParticle.deleteParticles = total.deleteParticles / divisor;
+		result.perParticle.updateSleep = total.updateSleep / divisor;
+		result.msPerStep = total.Total() / 1.0e6 / static_cast<double>(options.steps);
+		return result;
+	}
+
+	bool EndsWith(const std::string& text, const char* suffix)
+	{
+		const size_t length = std::strlen(suffix);
+		return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+	}
+
+	void WriteCsv(FILE* file, const std::vector<Result>& results)
+	{
+		std::fprintf(file, "scene,particles,averageParticles,balls,clothNodes,emitters,integrateBodies,solveCloth,particlePipeline,checkCollisions,resolveCollisions,deleteParticles,updateSleep,total,msPerStep\n");
+
+		for (size_t i = 0u; i < results.size(); ++i)
+		{
+			const Result& r = results[i];
+			const ParticleEngine::PhaseTimings& t = r.perParticle;
+			std::fprintf(file, "%s,%zu,%.1f,%zu,%zu,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n",
+				r.scene.c_str(), r.particleCount, r.averageParticles, r.balls, r.clothNodes,
+				t.emitters, t.integrateBodies, t.solveCloth, t.particlePipeline, t.checkCollisions, t.resolveCollisions, t.deleteParticles, t.updateSleep, t.Total(), r.msPerStep);
+		}
+	}
+
+	void WriteJson(FILE* file, const std::vector<Result>& results, const Options& options)
+	{
+		std::fprintf(file, "{\n");
+		std::fprintf(file, "\t\"instructionSet\": \"%s\",\n", SimdSupport::GetName(SimdSupport::GetActive()));
+		std::fprintf(file, "\t\"workers\": %zu,\n", results[0].workers);
+		std::fprintf(file, "\t\"steps\": %zu,\n", options.steps);
+		std::fprintf(file, "\t\"warmup\": %zu,\n", options.warmup);
+		std::fprintf(file, "\t\"deltaTime\": %g,\n", options.deltaTime);
+		std::fprintf(file, "\t\"seed\": %llu,\n", static_cast<unsigned long long>(options.seed));
+		std::fprintf(file, "\t\"unit\": \"ns per particle per step\",\n");
+		std::fprintf(file, "\t\"results\": [\n");
+
+		for (size_t i = 0u; i < results.size(); ++i)
+		{
+			const Result& r = results[i];
+			const ParticleEngine::PhaseTimings& t = r.perParticle;
+			std::fprintf(file, "\t\t{ \"scene\": \"%s\", \"particles\": %zu, \"averageParticles\": %.1f, \"balls\": %zu, \"clothNodes\": %zu, ",
+				r.scene.c_str(), r.particleCount, r.averageParticles, r.balls, r.clothNodes);
+			std::fprintf(file, "\"phases\": { \"emitters\": %.4f, \"integrateBodies\": %.4f, \"solveCloth\": %.4f, \"particlePipeline\": %.4f, \"checkCollisions\": %.4f, \"resolveCollisions\": %.4f, \"deleteParticles\": %.4f, \"updateSleep\": %.4f }, ",
+				t.emitters, t.integrateBodies, t.solveCloth, t.particlePipeline, t.checkCollisions, t.resolveCollisions, t.deleteParticles, t.updateSleep);
+			std::fprintf(file, "\"total\": %.4f, \"msPerStep\": %.4f }%s\n", t.Total(), r.msPerStep, i + 1u < results.size() ? "," : "");
+		}
+
+		std::fprintf(file, "\t]\n}\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		std::fprintf(stderr, "Usage: %s [--out file.json|file.csv] [--steps n] [--warmup n] [--dt seconds] [--seed n] [--scene name] [--max-particles n]\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<Result> results;
+
+	std::printf("%-8s %10s %12s %10s %10s\n", "scene", "particles", "avgAlive", "ns/p/step", "ms/step");
+
+	const std::vector<BenchmarkScenes::Scene>& scenes = BenchmarkScenes::GetScenes();
+	for (size_t s = 0u; s < scenes.size(); ++s)
+	{
+		if (!options.scene.empty() && options.scene != scenes[s].name)
+		{
+			continue;
+		}
+
+		for (size_t c = 0u; c < sizeof(particleCounts) / sizeof(particleCounts[0]); ++c)
+		{
+			if (particleCounts[c] > options.maxParticles)
+			{
+				continue;
+			}
+
+			results.push_back(Run(scenes[s], particleCounts[c], options));
+
+			const Result& r = results.back();
+			std::printf("%-8s %10zu %12.1f %10.3f %10.3f\n", r.scene.c_str(), r.particleCount, r.averageParticles, r.perParticle.Total(), r.msPerStep);
+			std::fflush(stdout);
+		}
+	}
+
+	if (results.empty())
+	{
+		std::fprintf(stderr, "No scene matches '%s'\n", options.scene.c_str());
+		return 1;
+	}
+
+	FILE* file = std::fopen(options.out.c_str(), "w");
+	if (!file)
+	{
+		std::fprintf(stderr, "Could not open %s\n", options.out.c_str());
+		return 1;
+	}
+
+	if (EndsWith(options.out, ".csv"))
+	{
+		WriteCsv(file, results);
+	}
+	else
+	{
+		WriteJson(file, results, options);
+	}
+
+	std::fclose(file);
+	std::printf("Results written to %s\n", options.out.c_str());
+
+	return 0;
+}
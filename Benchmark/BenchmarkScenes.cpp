@@ -0,0 +1,109 @@
+#include "BenchmarkScenes.h"
+#include "Config.hpp"
+#include "RandomStream.h"
+
+namespace
+{
+	const float width = static_cast<float>(Config::width);
+	const float height = static_cast<float>(Config::height);
+
+	//Walls, floor and ceiling of the default scene without the platforms
+	void AddArena(ParticleEngine& engine)
+	{
+		Solid wall;
+		wall.SetSize(glm::vec2(width * 0.45f, height));
+		wall.SetPosition(glm::vec2(width * -0.2f, height * 0.5f));
+		engine.AddSolid(wall);
+
+		wall.SetPosition(glm::vec2(width * 1.2f, height * 0.5f));
+		engine.AddSolid(wall);
+
+		Solid floor;
+		floor.SetSize(glm::vec2(width, height * 0.45f));
+		floor.SetPosition(glm::vec2(width * 0.5f, height * 1.2f));
+		engine.AddSolid(floor);
+
+		floor.SetPosition(glm::vec2(width * 0.5f, height * -0.2f));
+		engine.AddSolid(floor);
+	}
+
+	//Uniformly inside the arena with a random velocity, drawn in one batch
+	void FillParticles(ParticleEngine& engine, size_t particleCount, uint64_t seed)
+	{
+		//Emitters take the low stream numbers
+		RandomStream random(seed, 1000u);
+		std::vector<float> values(particleCount * 4u);
+		if (!values.empty())
+		{
+			random.FillFloats(&values[0], values.size());
+		}
+
+		const glm::vec2 min(width * 0.03f, height * 0.03f);
+		const glm::vec2 max(width * 0.97f, height * 0.97f);
+		const float maxSpeed = 50.0f;
+
+		engine.AddParticles(particleCount, [&](glm::vec2* positions, glm::vec2* velocities, size_t count, size_t offset)
+		{
+			for (size_t i = 0u; i < count; ++i)
+			{
+				const float* value = &values[(offset + i) * 4u];
+
+				positions[i].x = min.x + (max.x - min.x) * value[0];
+				positions[i].y = min.y + (max.y - min.y) * value[1];
+
+				velocities[i].x = (value[2] * 2.0f - 1.0f) * maxSpeed;
+				velocities[i].y = (value[3] * 2.0f - 1.0f) * maxSpeed;
+			}
+		});
+	}
+}
+
+void BenchmarkScenes::BuildDefault(ParticleEngine& engine, size_t particleCount, uint64_t seed)
+{
+	engine.LoadDefaultScene();
+	engine.SeedRandom(seed);
+	FillParticles(engine, particleCount, seed);
+}
+
+void BenchmarkScenes::BuildParticleFlood(ParticleEngine& engine, size_t particleCount, uint64_t seed)
+{
+	AddArena(engine);
+	FillParticles(engine, particleCount, seed);
+}
+
+void BenchmarkScenes::BuildBallPit(ParticleEngine& engine, size_t particleCount, uint64_t seed)
+{
+	AddArena(engine);
+
+	//Rows of touching balls over the lower half of the arena
+	const float spacing = Config::ballSize * 2.0f;
+	for (float y = height * 0.95f; y > height * 0.5f; y -= spacing)
+	{
+		for (float x = width * 0.05f; x < width * 0.95f; x += spacing)
+		{
+			engine.SpawnBall(glm::vec2(x, y));
+		}
+	}
+
+	FillParticles(engine, particleCount, seed);
+}
+
+void BenchmarkScenes::BuildClothHeavy(ParticleEngine& engine, size_t particleCount, uint64_t seed)
+{
+	AddArena(engine);
+	engine.SetCloth(60u, 30u, 6.0f, glm::vec2(width * 0.1f, height * 0.1f), 2.0f);
+	FillParticles(engine, particleCount, seed);
+}
+
+const std::vector<BenchmarkScenes::Scene>& BenchmarkScenes::GetScenes()
+{
+	static const std::vector<Scene> scenes =
+	{
+		{ "default", Config::maxBallCount, &BuildDefault },
+		{ "flood", 0u, &BuildParticleFlood },
+		{ "ballpit", 2048u, &BuildBallPit },
+		{ "cloth", Config::maxBallCount, &BuildClothHeavy },
+	};
+
+	return scenes;
+}
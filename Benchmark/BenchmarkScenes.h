@@ -0,0 +1,28 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "ParticleEngine.h"
+
+//Deterministic scenes for the benchmark, every builder fills the engine with exactly particleCount particles
+namespace BenchmarkScenes
+{
+	typedef void(*BuildFunction)(ParticleEngine& engine, size_t particleCount, uint64_t seed);
+
+	struct Scene
+	{
+		const char* name;
+		size_t ballCapacity;
+		BuildFunction build;
+	};
+
+	//The layout ParticleEngine() creates, emitters included
+	void BuildDefault(ParticleEngine& engine, size_t particleCount, uint64_t seed);
+	//Particles bouncing inside the arena walls, nothing else
+	void BuildParticleFlood(ParticleEngine& engine, size_t particleCount, uint64_t seed);
+	//Arena filled with resting balls, particles die on contact
+	void BuildBallPit(ParticleEngine& engine, size_t particleCount, uint64_t seed);
+	//Arena with a large cloth hanging in the middle
+	void BuildClothHeavy(ParticleEngine& engine, size_t particleCount, uint64_t seed);
+
+	const std::vector<Scene>& GetScenes();
+}
@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include "ParticleEngine.h"
+#include "SoftwareRenderer.h"
+#include "TrajectoryRecorder.h"
+#include "Config.hpp"
+#include "SimdSupport.h"
+#include "Profiler.h"
+#include "ParticleKernels.h"
+#include "RandomStream.h"
+
+//Steps the default scene without a window and prints how long it took.
+//Frames can be captured through the software renderer, as numbered PNGs and/or one raw RGBA stream.
+//--load starts from a snapshot instead of an empty scene, --save writes one after the last step.
+//--record writes the positions of every step as a compressed trajectory, see TrajectoryRecorder.
+//--scene replaces the default scene with a scene file, see SceneFile.
+//--verify only checks the vectorized paths against their scalar references and exits nonzero if they disagree.
+//Usage: Headless [steps] [deltaTime] [trace.json] [--png prefix] [--raw file] [--every n] [--load file] [--save file] [--record file] [--scene file] [--verify]
+int main(int argc, char** argv)
+{
+	size_t steps = 1000u;
+	float deltaTime = Config::fixedPhysicsUpdate;
+	const char* tracePath = nullptr;
+	const char* pngPrefix = nullptr;
+	const char* rawPath = nullptr;
+	size_t captureEvery = 1u;
+	const char* loadPath = nullptr;
+	const char* savePath = nullptr;
+	const char* recordPath = nullptr;
+	const char* scenePath = nullptr;
+	bool verify = false;
+
+	size_t positional = 0u;
+	bool valid = true;
+	for (int i = 1; i < argc && valid; ++i)
+	{
+		const bool hasValue = i + 1 < argc;
+
+		if (!std::strcmp(argv[i], "--png") && hasValue)
+		{
+			pngPrefix = argv[++i];
+		}
+		else if (!std::strcmp(argv[i], "--raw") && hasValue)
+		{
+			rawPath = argv[++i];
+		}
+		else if (!std::strcmp(argv[i], "--every") && hasValue)
+		{
+			captureEvery = static_cast<size_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (!std::strcmp(argv[i], "--load") && hasValue)
+		{
+			loadPath = argv[++i];
+		}
+		else if (!std::strcmp(argv[i], "--save") && hasValue)
+		{
+			savePath = argv[++i];
+		}
+		else if (!std::strcmp(argv[i], "--record") && hasValue)
+		{
+			recordPath = argv[++i];
+		}
+		else if (!std::strcmp(argv[i], "--scene") && hasValue)
+		{
+			scenePath = argv[++i];
+		}
+		else if (!std::strcmp(argv[i], "--verify"))
+		{
+			verify = true;
+		}
+		else if (argv[i][0] == '-' && argv[i][1] == '-')
+		{
+			valid = false;
+		}
+		else if (positional == 0u)
+		{
+			steps = static_cast<size_t>(std::strtoul(argv[i], nullptr, 10));
+			++positional;
+		}
+		else if (positional == 1u)
+		{
+			deltaTime = static_cast<float>(std::atof(argv[i]));
+			++positional;
+		}
+		else if (positional == 2u)
+		{
+			tracePath = argv[i];
+			++positional;
+		}
+		else
+		{
+			valid = false;
+		}
+	}
+
+	if (!valid || steps == 0u || deltaTime <= 0.0f || captureEvery == 0u)
+	{
+		std::fprintf(stderr, "Usage: %s [steps] [deltaTime] [trace.json] [--png prefix] [--raw file] [--every n] [--load file] [--save file] [--record file] [--scene file] [--verify]\n", argv[0]);
+		return 1;
+	}
+
+	if (verify)
+	{
+		const bool kernels = ParticleKernels::Verify(1e-5f);
+		const bool random = RandomStream::Verify();
+		std::printf("instructionSet: %s\n", SimdSupport::GetName(SimdSupport::GetActive()));
+		std::printf("kernels:        %s\n", kernels ? "ok" : "MISMATCH");
+		std::printf("randomStream:   %s\n", random ? "ok" : "MISMATCH");
+		return kernels && random ? 0 : 1;
+	}
+
+	SceneDescription scene = scenePath ? SceneDescription() : SceneDescription::Default();
+	std::string sceneError;
+	if (scenePath && !SceneFile::Load(scenePath, scene, &sceneError))
+	{
+		std::fprintf(stderr, "Could not load %s: %s\n", scenePath, sceneError.c_str());
+		return 1;
+	}
+
+	ParticleEngine engine(scene);
+
+	double loadTime = 0.0;
+	if (loadPath)
+	{
+		const uint64_t loadStart = Profiler::Now();
+		if (!engine.LoadSnapshot(loadPath))
+		{
+			std::fprintf(stderr, "Could not load %s\n", loadPath);
+			return 1;
+		}
+		loadTime = static_cast<double>(Profiler::Now() - loadStart) / 1.0e6;
+	}
+
+	//Only built when capturing, it owns a worker pool of its own
+	std::unique_ptr<SoftwareRenderer> renderer;
+	FILE* rawFile = nullptr;
+	size_t framesCaptured = 0u;
+	if (pngPrefix || rawPath)
+	{
+		renderer.reset(new SoftwareRenderer(Config::width, Config::height));
+	}
+	if (rawPath)
+	{
+		rawFile = std::fopen(rawPath, "wb");
+		if (!rawFile)
+		{
+			std::fprintf(stderr, "Could not write %s\n", rawPath);
+			return 1;
+		}
+	}
+
+	TrajectoryRecorder recorder;
+	if (recordPath && !recorder.Open(recordPath))
+	{
+		std::fprintf(stderr, "Could not write %s\n", recordPath);
+		return 1;
+	}
+
+	size_t pairsTested = 0u;
+	size_t pairsHit = 0u;
+	Profiler::FrameHistogram stepTimes(0.01f, 1000.0f);
+
+	const std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	for (size_t i = 0u; i < steps; ++i)
+	{
+		const uint64_t stepStart = Profiler::Now();
+		engine.Update(deltaTime);
+		if (recordPath)
+		{
+			recorder.Record(engine);
+		}
+		stepTimes.Add(static_cast<float>(Profiler::Now() - stepStart) / 1.0e6f);
+
+		pairsTested += engine.GetBroadphaseStats().pairsTested;
+		pairsHit += engine.GetBroadphaseStats().pairsHit;
+
+		if (renderer && (i + 1u) % captureEvery == 0u)
+		{
+			renderer->Render(engine);
+
+			if (pngPrefix)
+			{
+				char path[1024];
+				std::snprintf(path, sizeof(path), "%s%05zu.png", pngPrefix, framesCaptured);
+				if (!renderer->WritePng(path))
+				{
+					std::fprintf(stderr, "Could not write %s\n", path);
+					return 1;
+				}
+			}
+			if (rawFile && !renderer->WriteRaw(rawFile))
+			{
+				std::fprintf(stderr, "Could not write %s\n", rawPath);
+				return 1;
+			}
+			++framesCaptured;
+		}
+	}
+
+	if (rawFile)
+	{
+		std::fclose(rawFile);
+	}
+
+	if (recordPath && !recorder.Close())
+	{
+		std::fprintf(stderr, "Could not write %s\n", recordPath);
+		return 1;
+	}
+
+	if (savePath && !engine.SaveSnapshot(savePath))
+	{
+		std::fprintf(stderr, "Could not write %s\n", savePath);
+		return 1;
+	}
+
+	const std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+	std::printf("scene:          %s\n", scenePath ? scenePath : "default");
+	std::printf("steps:          %zu\n", steps);
+	std::printf("deltaTime:      %f s\n", deltaTime);
+	std::printf("instructionSet: %s\n", SimdSupport::GetName(SimdSupport::GetActive()));
+	std::printf("total:          %.3f ms\n", elapsed.count());
+	std::printf("perStep:        %.4f ms\n", elapsed.count() / static_cast<double>(steps));
+	std::printf("p50/p95/p99:    %.2f / %.2f / %.2f ms\n", stepTimes.GetPercentile(0.5f), stepTimes.GetPercentile(0.95f), stepTimes.GetPercentile(0.99f));
+	std::printf("particles:      %zu\n", engine.GetParticles().Size());
+	std::printf("balls:          %zu\n", engine.GetBalls().size());
+	std::printf("sleeping:       %zu particles, %zu balls\n", engine.GetSleepingParticleCount(), engine.GetSleepingBallCount());
+	std::printf("pairsTested:    %zu (%.1f per step)\n", pairsTested, static_cast<double>(pairsTested) / static_cast<double>(steps));
+	std::printf("pairsHit:       %zu (%.1f per step)\n", pairsHit, static_cast<double>(pairsHit) / static_cast<double>(steps));
+
+	if (loadPath)
+	{
+		std::printf("loaded:         %s (%.3f ms)\n", loadPath, loadTime);
+	}
+	if (savePath)
+	{
+		std::printf("saved:          %s\n", savePath);
+	}
+	if (recordPath)
+	{
+		std::printf("recorded:       %zu frames, %.2f MB (%.1fx smaller than raw), %zu stalls\n", recorder.GetFramesRecorded(),
+			static_cast<double>(recorder.GetBytesWritten()) / 1.0e6, static_cast<double>(recorder.GetRawBytes()) / static_cast<double>(std::max<uint64_t>(recorder.GetBytesWritten(), 1u)),
+			recorder.GetStallCount());
+	}
+
+	if (renderer)
+	{
+		std::printf("frames:         %zu (%zux%zu)\n", framesCaptured, renderer->GetWidth(), renderer->GetHeight());
+	}
+
+	if (tracePath)
+	{
+		if (!Profiler::WriteChromeTrace(tracePath))
+		{
+			std::fprintf(stderr, "Could not write %s\n", tracePath);
+			return 1;
+		}
+		std::printf("trace:          %s\n", tracePath);
+	}
+
+	return 0;
+}
@@ -8,4 +8,6 @@ Ball::Ball()
 	inverseMass = 1.0f / mass;
 	staticFriction = 0.25f;
 	kinematicFriction = 0.1f;
+	sleeping = false;
+	restSteps = 0u;
 }
@@ -7,4 +7,8 @@ struct Ball : public Particle
 	Ball();
 
 	float radius;
+
+	//Sleeping balls are neither integrated nor collision tested until something wakes them
+	bool sleeping;
+	size_t restSteps;
 };
@@ -1,11 +1,8 @@
 ﻿#include "BallGenerator.h"
 #include "ParticleEngine.h"
-#include "StaticXORShift.hpp"
 
 BallGenerator::BallGenerator()
 {
-	renderPoints.resize(0);
-	renderPoints.setPrimitiveType(sf::PrimitiveType::Lines);
 	points[0] = glm::vec2();
 	points[1] = glm::vec2();
 	spawnVector = glm::vec2();
@@ -27,22 +24,6 @@ BallGenerator::BallGenerator(const glm::vec2& start, const glm::vec2& end, float
 	spawnDirection = glm::normalize(spawnDirection);
 	spawnVector = glm::normalize(spawnVector);
 
-	renderPoints.setPrimitiveType(sf::PrimitiveType::Lines);
-	renderPoints.resize(4);
-
-	renderPoints[0].position.x = start.x;
-	renderPoints[0].position.y = start.y;
-	renderPoints[0].color = sf::Color::Cyan;
-	renderPoints[1].position.x = end.x;
-	renderPoints[1].position.y = end.y;
-	renderPoints[1].color = sf::Color::Cyan;
-	renderPoints[2].position.x = (start + end).x * 0.5f;
-	renderPoints[2].position.y = (start + end).y * 0.5f;
-	renderPoints[2].color = sf::Color::Cyan;
-	renderPoints[3].position.x = renderPoints[2].position.x + (spawnDirection.x * spawnVelocity);
-	renderPoints[3].position.y = renderPoints[2].position.y + (spawnDirection.y * spawnVelocity);
-	renderPoints[3].color = sf::Color::Cyan;
-
 	spawnCooldown = 1.0f;
 	spawnTime = spawnCooldown;
 }
@@ -53,22 +34,29 @@ BallGenerator::BallGenerator(const BallGenerator& other)
 	points[0] = other.points[0];
 	points[1] = other.points[1];
 
-	renderPoints = other.renderPoints;
 	spawnVector = other.spawnVector;
 	spawnDirection = other.spawnDirection;
 	spawnTime = other.spawnTime;
 	spawnCooldown = other.spawnCooldown;
+	random = other.random;
 }
 
 BallGenerator::~BallGenerator()
 {
 }
 
+void BallGenerator::RestoreState(float savedSpawnTime, uint64_t randomCounter)
+{
+	spawnTime = savedSpawnTime;
+	random.SetCounter(randomCounter);
+}
+
 void BallGenerator::Update(float deltaTime, ParticleEngine& engine)
 {
 	spawnTime += deltaTime;
 
-	if (spawnTime > spawnCooldown)
+	//Catch up on every ball that fell due during a long frame, a zero cooldown still spawns one per update
+	while (spawnTime > spawnCooldown)
 	{
 		spawnTime -= spawnCooldown;
 
@@ -77,15 +65,20 @@ void BallGenerator::Update(float deltaTime, ParticleEngine& engine)
 		ball.velocity = spawnDirection * spawnVelocity;
 
 		engine.AddBall(ball);
+
+		if (spawnCooldown <= 0.0f)
+		{
+			break;
+		}
 	}
 }
 
-void BallGenerator::Render(sf::RenderWindow& window)
+void BallGenerator::Seed(uint64_t seed, uint64_t stream)
 {
-	window.draw(renderPoints);
+	random.Seed(seed, stream);
 }
 
 glm::vec2 BallGenerator::GetRandomSpawnPoint()
 {
-	return points[0] + (glm::distance(points[0], points[1]) * StaticXorShift::GetZeroToOne()) * spawnVector;
+	return points[0] + (glm::distance(points[0], points[1]) * random.NextFloat()) * spawnVector;
 }
@@ -1,6 +1,6 @@
 ﻿#pragma once
 #include <glm/glm.hpp>
-#include "sfml/Graphics.hpp"
+#include "RandomStream.h"
 
 class ParticleEngine;
 
@@ -13,7 +13,19 @@ public:
 	~BallGenerator();
 
 	void Update(float deltaTime, ParticleEngine& engine);
-	void Render(sf::RenderWindow& window);
+
+	//Every generator draws from its own stream, so spawns do not depend on update order
+	void Seed(uint64_t seed, uint64_t stream);
+
+	const glm::vec2& GetStart() const { return points[0]; }
+	const glm::vec2& GetEnd() const { return points[1]; }
+	const glm::vec2& GetSpawnDirection() const { return spawnDirection; }
+	float GetSpawnVelocity() const { return spawnVelocity; }
+	float GetSpawnTime() const { return spawnTime; }
+	uint64_t GetRandomCounter() const { return random.GetCounter(); }
+
+	//Snapshot restore, the generator has to be seeded the way it was when the state was taken
+	void RestoreState(float savedSpawnTime, uint64_t randomCounter);
 
 private:
 	glm::vec2 GetRandomSpawnPoint();
@@ -25,7 +37,5 @@ private:
 	float spawnVelocity;
 	float spawnTime;
 	float spawnCooldown;
-
-	//Renderstuff
-	sf::VertexArray renderPoints;
+	RandomStream random;
 };
@@ -1,75 +1,78 @@
 ﻿#include "Blizzard.h"
-#include "Particle.h"
 #include "ParticleEngine.h"
 
 Blizzard::Blizzard(glm::vec2 position, size_t spawnCount)
 	: position(position)
 {
 	spawnPoints.resize(spawnCount);
-	spawnDirections.resize(spawnCount);
 	radius = 2.0f;
 
 	for(size_t i = 0u; i < spawnCount; ++i)
 	{
 		spawnPoints[i].x = position.x + radius * cos((2.0f * Config::pi / static_cast<float>(spawnCount)) * i);
 		spawnPoints[i].y = position.y + radius * sin((2.0f * Config::pi / static_cast<float>(spawnCount)) * i);
-
-		spawnDirections[i] = spawnPoints[i] - position;
-	}
-
-	vertices.resize(spawnPoints.size());
-
-	for (size_t i = 0; i < vertices.size(); ++i)
-	{
-		vertices[i].position.x = spawnPoints[i].x;
-		vertices[i].position.y = spawnPoints[i].y;
-		vertices[i].color = sf::Color::Red;
 	}
 
 	spawnTime = 0;
 	spawnVelocity = 100.0f;
 	spawnCooldown = 0.05f;
+	angularVelocity = Config::pi;
 }
 
 Blizzard::Blizzard(const Blizzard& other)
 {
 	radius = other.radius;
-	vertices = other.vertices;
 	spawnPoints = other.spawnPoints;
 	position = other.position;
 	spawnTime = other.spawnTime;
-	spawnDirections = other.spawnDirections;
 	spawnVelocity = other.spawnVelocity;
 	spawnCooldown = other.spawnCooldown;
+	angularVelocity = other.angularVelocity;
 }
 
-void Blizzard::DebugRender(sf::RenderWindow& window)
+void Blizzard::RestoreState(float savedSpawnTime, const glm::vec2* savedSpawnPoints)
 {
-	window.draw(&vertices[0], vertices.size(), sf::PrimitiveType::Points);
+	spawnTime = savedSpawnTime;
+	spawnPoints.assign(savedSpawnPoints, savedSpawnPoints + spawnPoints.size());
 }
 
 void Blizzard::Update(float deltaTime, ParticleEngine& engine)
 {
 	spawnTime += deltaTime;
 
-	Collisions::BoundingVolumes::RotateAroundPointRads(&spawnPoints[0], spawnPoints.size(), position, Config::pi * deltaTime);
+	Collisions::BoundingVolumes::RotateAroundPointRads(&spawnPoints[0], spawnPoints.size(), position, angularVelocity * deltaTime);
 
-	if(spawnTime > spawnCooldown)
+	if(spawnTime <= spawnCooldown)
 	{
-		spawnTime -= spawnCooldown;
-
-		for(size_t i = 0u; i < spawnPoints.size(); ++i)
-		{
-			Particle particle;
-			particle.position = spawnPoints[i];
-			particle.velocity = spawnDirections[i] * spawnVelocity;
-
-			engine.AddParticle(particle);
+		return;
+	}
 
-			spawnDirections[i] = spawnPoints[i] - position;
-		}
+	//A long frame spawns every batch that fell due during it, each one where the ring was at its due time
+	//and already moved along its velocity for the time since
+	const size_t batchCount = static_cast<size_t>(spawnTime / spawnCooldown);
+	const size_t perBatch = spawnPoints.size();
 
+	batchRotations.resize(batchCount);
+	for(size_t k = 0u; k < batchCount; ++k)
+	{
+		const float angle = -angularVelocity * (spawnTime - static_cast<float>(k + 1u) * spawnCooldown);
+		batchRotations[k] = glm::vec2(cos(angle), sin(angle));
 	}
 
+	engine.AddParticles(batchCount * perBatch, [&](glm::vec2* positions, glm::vec2* velocities, size_t count, size_t offset)
+	{
+		for(size_t i = 0u; i < count; ++i)
+		{
+			const size_t k = (offset + i) / perBatch;
+			const glm::vec2 direction = spawnPoints[(offset + i) % perBatch] - position;
+			const glm::vec2 rotation = batchRotations[k];
+			const glm::vec2 rotated(direction.x * rotation.x - direction.y * rotation.y, direction.x * rotation.y + direction.y * rotation.x);
+			const float age = spawnTime - static_cast<float>(k + 1u) * spawnCooldown;
+
+			velocities[i] = rotated * spawnVelocity;
+			positions[i] = position + rotated + velocities[i] * age;
+		}
+	});
 
+	spawnTime -= static_cast<float>(batchCount) * spawnCooldown;
 }
@@ -1,7 +1,6 @@
 ﻿#pragma once
 #include <glm/glm.hpp>
 #include <vector>
-#include "sfml/Graphics.hpp"
 
 class ParticleEngine;
 
@@ -11,19 +10,24 @@ public:
 	Blizzard(glm::vec2 position, size_t spawnCount);
 	Blizzard(const Blizzard& other);
 
-	void DebugRender(sf::RenderWindow& window);
 	void Update(float deltaTime, ParticleEngine& engine);
 
+	const std::vector<glm::vec2>& GetSpawnPoints() const { return spawnPoints; }
+	float GetSpawnTime() const { return spawnTime; }
+
+	//Snapshot restore, savedSpawnPoints holds as many points as GetSpawnPoints
+	void RestoreState(float savedSpawnTime, const glm::vec2* savedSpawnPoints);
+
 private:
 
 	std::vector<glm::vec2> spawnPoints;
-	std::vector<glm::vec2> spawnDirections;
 	glm::vec2 position;
 	float radius;
 	float spawnVelocity;
 	float spawnTime;
 	float spawnCooldown;
+	float angularVelocity; //Radians per second
 
-	//Renderstuff
-	std::vector<sf::Vertex> vertices;
+	//Rotation back to where the spawn points were for every batch due this frame, as (cos, sin)
+	std::vector<glm::vec2> batchRotations;
 };
@@ -0,0 +1,237 @@
+#include "ClothSolver.h"
+#include "Collision.hpp"
+#include "Config.hpp"
+#include <algorithm>
+
+ClothSolver::ClothSolver()
+	: m_lastBatchSerial(false)
+	, m_exclusionStart(1u, 0u)
+	, m_iterations(Config::clothIterations)
+	, m_compliance(Config::clothCompliance)
+{
+}
+
+void ClothSolver::Clear()
+{
+	m_constraints.clear();
+	m_lambda.clear();
+	m_inverseMass.clear();
+	m_batchStart.clear();
+	m_lastBatchSerial = false;
+	m_exclusionStart.assign(1u, 0u);
+	m_exclusions.clear();
+}
+
+void ClothSolver::AddConstraint(uint32_t a, uint32_t b, float restLength)
+{
+	Constraint constraint;
+	constraint.a = a;
+	constraint.b = b;
+	constraint.restLength = restLength;
+	m_constraints.push_back(constraint);
+}
+
+void ClothSolver::Build(const std::vector<Ball>& nodes, size_t pinnedCount, size_t exclusionHops)
+{
+	BuildExclusions(nodes.size(), exclusionHops);
+
+	m_inverseMass.resize(nodes.size());
+	for (size_t i = 0u; i < nodes.size(); ++i)
+	{
+		m_inverseMass[i] = i < pinnedCount ? 0.0f : nodes[i].inverseMass;
+	}
+
+	//Greedy coloring, every constraint takes the lowest color neither of its nodes uses yet
+	std::vector<uint64_t> nodeColors(nodes.size(), 0u);
+	std::vector<uint32_t> colors(m_constraints.size());
+	std::vector<size_t> colorCounts(maxColors + 1u, 0u);
+
+	for (size_t i = 0u; i < m_constraints.size(); ++i)
+	{
+		const uint64_t used = nodeColors[m_constraints[i].a] | nodeColors[m_constraints[i].b];
+
+		size_t color = 0u;
+		while (color < maxColors && (used & (uint64_t(1u) << color)) != 0u)
+		{
+			++color;
+		}
+
+		if (color < maxColors)
+		{
+			nodeColors[m_constraints[i].a] |= uint64_t(1u) << color;
+			nodeColors[m_constraints[i].b] |= uint64_t(1u) << color;
+		}
+
+		colors[i] = static_cast<uint32_t>(color);
+		++colorCounts[color];
+	}
+
+	//Counting sort into contiguous batches, stable so the projection order inside a color stays the insertion order
+	size_t colorCount = 0u;
+	for (size_t c = 0u; c <= maxColors; ++c)
+	{
+		if (colorCounts[c] > 0u)
+		{
+			colorCount = c + 1u;
+		}
+	}
+	m_lastBatchSerial = colorCount > maxColors;
+
+	m_batchStart.assign(colorCount + 1u, 0u);
+	for (size_t c = 0u; c < colorCount; ++c)
+	{
+		m_batchStart[c + 1u] = m_batchStart[c] + colorCounts[c];
+	}
+
+	std::vector<size_t> cursor(m_batchStart.begin(), m_batchStart.end() - 1);
+	std::vector<Constraint> sorted(m_constraints.size());
+	for (size_t i = 0u; i < m_constraints.size(); ++i)
+	{
+		sorted[cursor[colors[i]]++] = m_constraints[i];
+	}
+
+	m_constraints.swap(sorted);
+	m_lambda.resize(m_constraints.size());
+}
+
+void ClothSolver::Solve(std::vector<Ball>& nodes, float deltaTime, JobSystem& jobs)
+{
+	if (m_constraints.empty() || deltaTime <= 0.0f)
+	{
+		return;
+	}
+
+	m_predicted.resize(nodes.size());
+	for (size_t i = 0u; i < nodes.size(); ++i)
+	{
+		m_predicted[i] = nodes[i].position;
+	}
+
+	//Lagrange multipliers accumulate over the iterations of one step only
+	std::fill(m_lambda.begin(), m_lambda.end(), 0.0f);
+	const float alphaTilde = m_compliance / (deltaTime * deltaTime);
+
+	for (size_t iteration = 0u; iteration < m_iterations; ++iteration)
+	{
+		for (size_t c = 0u; c + 1u < m_batchStart.size(); ++c)
+		{
+			const size_t first = m_batchStart[c];
+			const size_t count = m_batchStart[c + 1u] - first;
+
+			if (m_lastBatchSerial && c + 2u == m_batchStart.size())
+			{
+				for (size_t i = first; i < first + count; ++i)
+				{
+					Project(nodes, i, alphaTilde);
+				}
+				continue;
+			}
+
+			jobs.ParallelFor(count, Config::clothConstraintChunkSize, [&](size_t begin, size_t end, size_t)
+			{
+				for (size_t i = first + begin; i < first + end; ++i)
+				{
+					Project(nodes, i, alphaTilde);
+				}
+			});
+		}
+	}
+
+	//Corrections count as motion, otherwise the next step integrates the stretch right back in
+	const float inverseDeltaTime = 1.0f / deltaTime;
+	for (size_t i = 0u; i < nodes.size(); ++i)
+	{
+		if (m_inverseMass[i] > 0.0f)
+		{
+			nodes[i].velocity += (nodes[i].position - m_predicted[i]) * inverseDeltaTime;
+		}
+	}
+}
+
+void ClothSolver::Project(std::vector<Ball>& nodes, size_t constraint, float alphaTilde)
+{
+	const Constraint& c = m_constraints[constraint];
+	Ball& a = nodes[c.a];
+	Ball& b = nodes[c.b];
+
+	const float weight = m_inverseMass[c.a] + m_inverseMass[c.b];
+	if (weight + alphaTilde <= 0.0f)
+	{
+		return;
+	}
+
+	const glm::vec2 delta = a.position - b.position;
+	const float length = Collisions::saveLength(delta);
+	if (length <= 0.0f)
+	{
+		return;
+	}
+
+	const float error = length - c.restLength;
+	const float deltaLambda = (-error - alphaTilde * m_lambda[constraint]) / (weight + alphaTilde);
+	m_lambda[constraint] += deltaLambda;
+
+	const glm::vec2 correction = (deltaLambda / length) * delta;
+	a.position += m_inverseMass[c.a] * correction;
+	b.position -= m_inverseMass[c.b] * correction;
+}
+
+void ClothSolver::BuildExclusions(size_t nodeCount, size_t hops)
+{
+	//Constraint graph as adjacency lists
+	std::vector<uint32_t> adjacencyStart(nodeCount + 1u, 0u);
+	for (size_t i = 0u; i < m_constraints.size(); ++i)
+	{
+		++adjacencyStart[m_constraints[i].a + 1u];
+		++adjacencyStart[m_constraints[i].b + 1u];
+	}
+	for (size_t i = 0u; i < nodeCount; ++i)
+	{
+		adjacencyStart[i + 1u] += adjacencyStart[i];
+	}
+
+	std::vector<uint32_t> adjacency(adjacencyStart.back());
+	std::vector<uint32_t> cursor(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (size_t i = 0u; i < m_constraints.size(); ++i)
+	{
+		adjacency[cursor[m_constraints[i].a]++] = m_constraints[i].b;
+		adjacency[cursor[m_constraints[i].b]++] = m_constraints[i].a;
+	}
+
+	//Breadth first search limited to hops from every node, visited is stamped with the source to avoid clearing it
+	m_exclusionStart.assign(nodeCount + 1u, 0u);
+	m_exclusions.clear();
+
+	std::vector<uint32_t> visited(nodeCount, UINT32_MAX);
+	std::vector<uint32_t> frontier;
+	std::vector<uint32_t> next;
+
+	for (uint32_t source = 0u; source < nodeCount; ++source)
+	{
+		const size_t first = m_exclusions.size();
+		visited[source] = source;
+		frontier.assign(1u, source);
+
+		for (size_t hop = 0u; hop < hops && !frontier.empty(); ++hop)
+		{
+			next.clear();
+			for (size_t f = 0u; f < frontier.size(); ++f)
+			{
+				for (uint32_t e = adjacencyStart[frontier[f]]; e < adjacencyStart[frontier[f] + 1u]; ++e)
+				{
+					const uint32_t node = adjacency[e];
+					if (visited[node] != source)
+					{
+						visited[node] = source;
+						next.push_back(node);
+						m_exclusions.push_back(node);
+					}
+				}
+			}
+			frontier.swap(next);
+		}
+
+		std::sort(m_exclusions.begin() + first, m_exclusions.end());
+		m_exclusionStart[source + 1u] = static_cast<uint32_t>(m_exclusions.size());
+	}
+}
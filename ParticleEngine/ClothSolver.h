@@ -0,0 +1,76 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "Ball.h"
+#include "JobSystem.h"
+
+//Extended position based dynamics (XPBD) for the cloth distance constraints.
+//Constraints refer to nodes by index, so the node array may reallocate freely.
+//They are greedily graph colored, no two constraints of one color share a node,
+//which lets every color batch be projected in parallel without locks.
+class ClothSolver
+{
+public:
+	struct Constraint
+	{
+		uint32_t a;
+		uint32_t b;
+		float restLength;
+	};
+
+	ClothSolver();
+
+	void Clear();
+	void AddConstraint(uint32_t a, uint32_t b, float restLength);
+	//Colors the constraints and takes the inverse masses of the nodes, the first pinnedCount nodes never move.
+	//Also collects the nodes up to exclusionHops constraints apart for IsExcluded.
+	//Has to be called again after constraints were added.
+	void Build(const std::vector<Ball>& nodes, size_t pinnedCount, size_t exclusionHops);
+
+	//Projects all constraints onto the positions Integrate predicted and turns the corrections into velocity
+	void Solve(std::vector<Ball>& nodes, float deltaTime, JobSystem& jobs);
+
+	//compliance is the inverse stiffness, 0 makes the constraints rigid
+	void SetIterations(size_t iterations) { m_iterations = iterations; }
+	void SetCompliance(float compliance) { m_compliance = compliance; }
+	size_t GetIterations() const { return m_iterations; }
+	float GetCompliance() const { return m_compliance; }
+
+	//Ordered by color after Build
+	const std::vector<Constraint>& GetConstraints() const { return m_constraints; }
+	size_t GetColorCount() const { return m_batchStart.empty() ? 0u : m_batchStart.size() - 1u; }
+
+	//True if the two nodes are within the exclusion hops of each other, their contacts would only fight the constraints
+	bool IsExcluded(uint32_t a, uint32_t b) const
+	{
+		if (a >= m_exclusionStart.size() - 1u)
+		{
+			return false;
+		}
+
+		return std::binary_search(m_exclusions.begin() + m_exclusionStart[a], m_exclusions.begin() + m_exclusionStart[a + 1u], b);
+	}
+
+private:
+	//Colors are tracked as a bit mask per node, constraints that find every color taken share a serial batch
+	const static size_t maxColors = 64u;
+
+	void Project(std::vector<Ball>& nodes, size_t constraint, float alphaTilde);
+	void BuildExclusions(size_t nodeCount, size_t hops);
+
+	std::vector<Constraint> m_constraints;
+	std::vector<float> m_lambda;
+	std::vector<float> m_inverseMass;
+	std::vector<glm::vec2> m_predicted;
+	std::vector<size_t> m_batchStart;
+	bool m_lastBatchSerial;
+
+	//Sorted k hop neighbourhood of every node, node i owns [m_exclusionStart[i], m_exclusionStart[i + 1])
+	std::vector<uint32_t> m_exclusionStart;
+	std::vector<uint32_t> m_exclusions;
+
+	size_t m_iterations;
+	float m_compliance;
+};
@@ -1,8 +1,11 @@
 #pragma once
 #include <glm/glm.hpp>
 #include "Config.hpp"
-#include <glm/gtx/matrix_transform_2d.hpp>
 #include <glm/gtx/norm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
 #define GLM_FORCE_RADIANS
 
 namespace Collisions
@@ -19,9 +22,17 @@ namespace Collisions
 		{
 			glm::vec2 center;
 			glm::vec2 halfSize;
-			glm::vec2 u[2]; //X and Y axis
+			glm::vec2 u[2]; //X and Y axis, also the rows of the world to local rotation
+			glm::vec2 localOffset; //World to local translation, cached by UpdateLocalFrame
 		};
 
+		//Has to run whenever center or axes change
+		static void UpdateLocalFrame(OOBB& oobb)
+		{
+			oobb.localOffset.x = -glm::dot(oobb.center, oobb.u[0]);
+			oobb.localOffset.y = -glm::dot(oobb.center, oobb.u[1]);
+		}
+
 		static void RotateAroundPointDegrees(glm::vec2* points, size_t count, glm::vec2& center, float angle)
 		{
 			float radians = angle * (Config::pi / 180.0f);
@@ -97,26 +108,14 @@ namespace Collisions
 		return distance;
 	}
 
-	static glm::vec2 WorldToLocal(const glm::vec2& worldPoint, const glm::vec2& localTranslation, const glm::vec2& localAxis)
+	static glm::vec2 WorldToLocal(const BoundingVolumes::OOBB& oobb, const glm::vec2& worldPoint)
 	{
-		float angle = glm::acos(glm::dot(glm::vec2(1.0f, 0.0f), localAxis));
-
-		glm::mat3x3 boxMatrix = glm::mat3x3();
-		boxMatrix = glm::translate(boxMatrix, localTranslation);
-		boxMatrix = glm::rotate(boxMatrix, angle);
-
-		return glm::inverse(boxMatrix) * glm::vec3(worldPoint.x, worldPoint.y, 1);
+		return glm::vec2(glm::dot(worldPoint, oobb.u[0]), glm::dot(worldPoint, oobb.u[1])) + oobb.localOffset;
 	}
 
-	static glm::vec2 LocalToWorld(const glm::vec2& localPoint, const glm::vec2& localTranslation, const glm::vec2& localAxis)
+	static glm::vec2 LocalToWorld(const BoundingVolumes::OOBB& oobb, const glm::vec2& localPoint)
 	{
-		float angle = glm::acos(glm::dot(glm::vec2(1.0f, 0.0f), localAxis));
-
-		glm::mat3x3 boxMatrix = glm::mat3x3();
-		boxMatrix = glm::translate(boxMatrix, localTranslation);
-		boxMatrix = glm::rotate(boxMatrix, angle);
-
-		return boxMatrix * glm::vec3(localPoint.x, localPoint.y, 1);
+		return oobb.center + oobb.u[0] * localPoint.x + oobb.u[1] * localPoint.y;
 	}
 
 	static bool PointBoxCollision(const glm::vec2& point, const BoundingVolumes::AABB& aabb)
@@ -137,17 +136,17 @@ namespace Collisions
 
 	static bool PointBoxCollision(const BoundingVolumes::OOBB& oobb, const glm::vec2& point, Contact& contact)
 	{
-		glm::vec2 relativePoint = WorldToLocal(point, oobb.center, oobb.u[0]);
+		glm::vec2 relativePoint = WorldToLocal(oobb, point);
 
 		//Check axis where penetration is least deep
-		float minDepth = oobb.halfSize.x - abs(relativePoint.x);
+		float minDepth = oobb.halfSize.x - std::abs(relativePoint.x);
 		if (minDepth < 0)
 		{
 			return false;
 		}
 		glm::vec2 normal = oobb.u[0] * (relativePoint.x < 0 ? -1.0f : 1.0f);
 
-		float depth = oobb.halfSize.y - abs(relativePoint.y);
+		float depth = oobb.halfSize.y - std::abs(relativePoint.y);
 		if(depth < 0)
 		{
 			return false;
@@ -208,11 +207,11 @@ namespace Collisions
 
 	static bool SphereBoxCollision(const glm::vec2& sphereCenter, const float sphereRadius, const BoundingVolumes::OOBB& oobb, Contact& contact)
 	{
-		glm::vec2 relCenter = WorldToLocal(sphereCenter, oobb.center, oobb.u[0]);
+		glm::vec2 relCenter = WorldToLocal(oobb, sphereCenter);
 
 		//Early Exits
-		if(		abs(relCenter.x) - sphereRadius > oobb.halfSize.x
-			||	abs(relCenter.y) - sphereRadius > oobb.halfSize.y)
+		if(		std::abs(relCenter.x) - sphereRadius > oobb.halfSize.x
+			||	std::abs(relCenter.y) - sphereRadius > oobb.halfSize.y)
 		{
 			return false;
 		}
@@ -237,8 +236,15 @@ namespace Collisions
 			return false;
 		}
 
+		//A center inside the box has no closest point to push away from, it leaves through the nearest face like a point
+		if (distance == 0.0f && PointBoxCollision(oobb, sphereCenter, contact))
+		{
+			contact.penetration += sphereRadius;
+			return true;
+		}
+
 		//Setup contact data
-		closestPoint = LocalToWorld(closestPoint, oobb.center, oobb.u[0]);
+		closestPoint = LocalToWorld(oobb, closestPoint);
 
 		contact.contactNormal = saveNormalize(sphereCenter - closestPoint);
 		contact.penetration = sphereRadius - distance;
@@ -262,6 +268,136 @@ namespace Collisions
 		return true;
 	}
 
-	
+	//Continuous test of a sphere moving from start to end, a radius of zero sweeps a point.
+	//Only counts if the sphere starts outside and enters the box during the move, timeOfImpact is the fraction of the move before it does.
+	//The contact normal is the one at the entry and the penetration pushes end back out to the entry plane,
+	//so a body that went through a thin solid in one step gets resolved on the side it came from.
+	static bool SweptSphereBoxCollision(const BoundingVolumes::OOBB& oobb, const glm::vec2& start, const glm::vec2& end, const float sphereRadius, Contact& contact, float& timeOfImpact)
+	{
+		//Segment against the box grown by the radius, slab by slab in box space
+		const glm::vec2 localStart = WorldToLocal(oobb, start);
+		const glm::vec2 localMove = WorldToLocal(oobb, end) - localStart;
+		const glm::vec2 halfSize = oobb.halfSize + glm::vec2(sphereRadius);
+
+		float enter = 0.0f;
+		float exit = 1.0f;
+		glm::vec2 localNormal(0.0f);
+
+		for (int axis = 0; axis < 2; ++axis)
+		{
+			if (std::abs(localMove[axis]) < 1e-6f)
+			{
+				if (std::abs(localStart[axis]) >= halfSize[axis])
+				{
+					return false;
+				}
+				continue;
+			}
+
+			//Moving in positive direction enters through the negative face
+			float slabEnter = (-halfSize[axis] - localStart[axis]) / localMove[axis];
+			float slabExit = (halfSize[axis] - localStart[axis]) / localMove[axis];
+			float side = -1.0f;
+			if (slabEnter > slabExit)
+			{
+				std::swap(slabEnter, slabExit);
+				side = 1.0f;
+			}
+
+			if (slabEnter > enter)
+			{
+				enter = slabEnter;
+				localNormal = glm::vec2(0.0f);
+				localNormal[axis] = side;
+			}
+			exit = std::min(exit, slabExit);
+
+			if (enter > exit)
+			{
+				return false;
+			}
+		}
+
+		//No entry face means the move started inside, the discrete tests handle that
+		if (localNormal == glm::vec2(0.0f))
+		{
+			return false;
+		}
+
+		//Past both faces of a corner the grown box is rounded, the sphere has to hit the corner circle instead
+		glm::vec2 localHit = localStart + localMove * enter;
+		if (std::abs(localHit.x) > oobb.halfSize.x && std::abs(localHit.y) > oobb.halfSize.y)
+		{
+			const glm::vec2 corner(localHit.x < 0.0f ? -oobb.halfSize.x : oobb.halfSize.x, localHit.y < 0.0f ? -oobb.halfSize.y : oobb.halfSize.y);
+			const glm::vec2 relativeStart = localStart - corner;
+
+			const float a = glm::dot(localMove, localMove);
+			const float b = glm::dot(relativeStart, localMove);
+			const float c = glm::dot(relativeStart, relativeStart) - sphereRadius * sphereRadius;
+			const float discriminant = b * b - a * c;
+			if (discriminant < 0.0f)
+			{
+				return false;
+			}
+
+			enter = (-b - std::sqrt(discriminant)) / a;
+			if (enter < 0.0f || enter > 1.0f)
+			{
+				return false;
+			}
+
+			localHit = localStart + localMove * enter;
+			localNormal = saveNormalize(localHit - corner);
+		}
+
+		const glm::vec2 normal = oobb.u[0] * localNormal.x + oobb.u[1] * localNormal.y;
+		const glm::vec2 hit = start + (end - start) * enter;
+
+		contact.contactNormal = normal;
+		contact.penetration = std::max(glm::dot(hit - end, normal), 0.0f);
+		timeOfImpact = enter;
+
+		return true;
+	}
+
+	//Batched narrow phase against a single box, tests points[indices[0..count)] and appends a contact for every hit
+	static size_t PointsBoxCollision(const BoundingVolumes::OOBB& oobb, const glm::vec2* points, const uint32_t* indices, size_t count, std::vector<Contact>& contacts)
+	{
+		size_t hits = 0u;
+		Contact contact;
+
+		for (size_t i = 0u; i < count; ++i)
+		{
+			if (PointBoxCollision(oobb, points[indices[i]], contact))
+			{
+				contact.index = indices[i];
+				contacts.push_back(contact);
+				++hits;
+			}
+		}
+
+		return hits;
+	}
+
+	//Same for spheres, Sphere needs a position and a radius member
+	template<typename Sphere>
+	static size_t SpheresBoxCollision(const BoundingVolumes::OOBB& oobb, const Sphere* spheres, const uint32_t* indices, size_t count, std::vector<Contact>& contacts)
+	{
+		size_t hits = 0u;
+		Contact contact;
+
+		for (size_t i = 0u; i < count; ++i)
+		{
+			const Sphere& sphere = spheres[indices[i]];
+			if (SphereBoxCollision(sphere.position, sphere.radius, oobb, contact))
+			{
+				contact.index = indices[i];
+				contacts.push_back(contact);
+				++hits;
+			}
+		}
+
+		return hits;
+	}
 }
 
@@ -14,4 +14,29 @@ namespace Config
 	const static bool useVsync = true;
 	const static bool useFixedUpdate = false;
 	const static float fixedPhysicsUpdate = 1.0f / 60.0f;
+	const static size_t maxSubsteps = 4; //Fixed steps per frame before frame time gets dropped
+	const static bool parallelParticleCompaction = true;
+	const static size_t workerCount = 0; //0 uses every hardware thread
+	const static size_t particleChunkSize = 4096;
+	const static size_t particleBlockSize = 256; //Particles every ParticlePipeline stage handles before the next one runs, sized for the L1 cache
+	const static bool enableProfiler = true;
+	const static float frameStatsWindow = 5.0f; //Seconds the frame time percentiles cover
+	const static size_t clothIterations = 8;
+	const static float clothCompliance = 0.000001f; //Inverse stiffness of the cloth constraints, 0 is rigid
+	const static size_t clothConstraintChunkSize = 256;
+	const static size_t clothCollisionExclusionHops = 2; //Cloth nodes this close in the constraint graph never collide
+	const static bool enableSleeping = true;
+	const static float sleepSpeed = 25.0f; //Bodies in contact and slower than this count as resting, above the contact jitter
+	const static size_t sleepSteps = 30; //Resting steps before a body or island falls asleep, at most ParticleFlags::RestLimit
+	const static bool enableContinuousCollision = true;
+	const static size_t contactIterations = 4; //Velocity and position passes of the ball ContactSolver, warm starting keeps stacks stable with few
+	const static float contactSlop = 0.5f; //Overlap in pixels ball contacts keep, so resting pairs stay in contact and find their cached impulses
+	const static float contactCorrection = 0.8f; //Share of the remaining overlap every position pass removes
+	const static float contactBounceSpeed = 30.0f; //Balls bounce off each other and solids only when they approach faster than this
+	const static float sweepFraction = 0.5f; //Bodies moving further per step than this fraction of the thinnest solids half size are swept against the solids
+	const static float forceFieldCellSize = 16.0f; //Pixels between the samples of the rasterized fan accelerations
+	const static size_t renderTileSize = 64; //Pixels per side of a SoftwareRenderer tile
+	const static float recordQuantization = 1.0f / 64.0f; //Position resolution of recorded trajectories in pixels
+	const static size_t recordQueueDepth = 4; //Recorded frames waiting for the writer before the simulation stalls
+	const static size_t recordKeyframeInterval = 300; //Frames between two recorded frames that do not depend on the previous one
 }
@@ -0,0 +1,246 @@
+#include "ContactSolver.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	uint64_t MakeKey(uint32_t a, uint32_t b)
+	{
+		return (static_cast<uint64_t>(a) << 32) | b;
+	}
+
+	glm::vec2 Tangent(const glm::vec2& normal)
+	{
+		return glm::vec2(-normal.y, normal.x);
+	}
+}
+
+ContactSolver::ContactSolver()
+	: m_iterations(Config::contactIterations)
+	, m_warmStarted(0u)
+{
+}
+
+void ContactSolver::Reserve(size_t ballCount, size_t contactCount)
+{
+	m_contacts.reserve(contactCount);
+	m_cache.reserve(contactCount);
+	m_nextCache.reserve(contactCount);
+	m_shift.reserve(ballCount);
+}
+
+void ContactSolver::Clear()
+{
+	m_contacts.clear();
+	m_cache.clear();
+	m_warmStarted = 0u;
+}
+
+void ContactSolver::EraseBall(uint32_t ball)
+{
+	//Lowering every index above ball by one keeps the order, the cache stays sorted
+	size_t kept = 0u;
+	for (size_t i = 0u; i < m_cache.size(); ++i)
+	{
+		CachedContact contact = m_cache[i];
+		if (contact.a == ball || contact.b == ball)
+		{
+			continue;
+		}
+
+		contact.a -= contact.a > ball ? 1u : 0u;
+		contact.b -= (contact.b & solidBit) == 0u && contact.b > ball ? 1u : 0u;
+		m_cache[kept++] = contact;
+	}
+	m_cache.resize(kept);
+}
+
+void ContactSolver::Restore(const CachedContact* contacts, size_t count)
+{
+	m_cache.assign(contacts, contacts + count);
+	std::sort(m_cache.begin(), m_cache.end(), [](const CachedContact& l, const CachedContact& r)
+	{
+		return MakeKey(l.a, l.b) < MakeKey(r.a, r.b);
+	});
+}
+
+void ContactSolver::AddContact(uint32_t a, uint32_t b, const glm::vec2& normal, float penetration)
+{
+	Contact contact;
+	contact.a = a;
+	contact.b = b;
+	contact.normal = normal;
+
+	//A ball pair may be reported from either side, the lower index comes first so it always finds its cache entry
+	if ((b & solidBit) == 0u && b < a)
+	{
+		contact.a = b;
+		contact.b = a;
+		contact.normal = -normal;
+	}
+
+	contact.key = MakeKey(contact.a, contact.b);
+	contact.penetration = penetration;
+	contact.normalImpulse = 0.0f;
+	contact.tangentImpulse = 0.0f;
+	m_contacts.push_back(contact);
+}
+
+void ContactSolver::Solve(std::vector<Ball>& balls, const std::vector<uint8_t>& integrated)
+{
+	std::sort(m_contacts.begin(), m_contacts.end(), [](const Contact& l, const Contact& r) { return l.key < r.key; });
+
+	//Both lists are sorted, one merge pass hands the cached impulses to the pairs found again
+	m_warmStarted = 0u;
+	size_t cached = 0u;
+	for (size_t i = 0u; i < m_contacts.size(); ++i)
+	{
+		Contact& contact = m_contacts[i];
+		while (cached < m_cache.size() && MakeKey(m_cache[cached].a, m_cache[cached].b) < contact.key)
+		{
+			++cached;
+		}
+		if (cached < m_cache.size() && MakeKey(m_cache[cached].a, m_cache[cached].b) == contact.key)
+		{
+			contact.normalImpulse = m_cache[cached].normalImpulse;
+			contact.tangentImpulse = m_cache[cached].tangentImpulse;
+			++m_warmStarted;
+		}
+
+		const Ball& a = balls[contact.a];
+		const bool solid = (contact.b & solidBit) != 0u;
+		const glm::vec2 velocityB = solid ? glm::vec2(0.0f) : balls[contact.b].velocity;
+
+		//Two balls woken during the collision checks hold still against each other, the contacts below them may not be found before the next step.
+		//Hit by an integrated ball or resting on a solid a woken ball takes its share, or the momentum of the impact that woke it would be lost.
+		const bool held = !solid && !integrated[contact.a] && !integrated[contact.b];
+		contact.inverseMassA = held ? 0.0f : a.inverseMass;
+		contact.inverseMassB = solid || held ? 0.0f : balls[contact.b].inverseMass;
+		contact.normalMass = contact.inverseMassA + contact.inverseMassB > 0.0f ? 1.0f / (contact.inverseMassA + contact.inverseMassB) : 0.0f;
+		contact.friction = solid ? a.staticFriction : std::sqrt(a.staticFriction * balls[contact.b].staticFriction);
+
+		//Only impacts bounce, a resting contact aims for zero normal velocity or it would never settle
+		const float normalVelocity = glm::dot(a.velocity - velocityB, contact.normal);
+		const float bounciness = solid ? a.bounciness : std::max(a.bounciness, balls[contact.b].bounciness);
+		contact.bounce = normalVelocity < -Config::contactBounceSpeed ? -bounciness * normalVelocity : 0.0f;
+	}
+
+	WarmStart(balls);
+	for (size_t iteration = 0u; iteration < m_iterations; ++iteration)
+	{
+		SolveVelocities(balls);
+	}
+	SolvePositions(balls);
+	UpdateCache(balls);
+	m_contacts.clear();
+}
+
+void ContactSolver::UpdateCache(const std::vector<Ball>& balls)
+{
+	//Sleeping balls report no contacts, their pairs keep the last impulses so a stack that is woken holds its load from the first step.
+	//A ball woken this step may not have reported its pairs yet, so only pairs of two awake balls that were not found again are dropped.
+	m_nextCache.clear();
+	size_t cached = 0u;
+	for (size_t i = 0u; i <= m_contacts.size(); ++i)
+	{
+		const uint64_t key = i < m_contacts.size() ? m_contacts[i].key : ~uint64_t(0u);
+		for (; cached < m_cache.size() && MakeKey(m_cache[cached].a, m_cache[cached].b) <= key; ++cached)
+		{
+			const CachedContact& contact = m_cache[cached];
+			const bool solid = (contact.b & solidBit) != 0u;
+			const bool asleep = (contact.a < balls.size() && balls[contact.a].sleeping) || (!solid && contact.b < balls.size() && balls[contact.b].sleeping);
+			if (asleep && MakeKey(contact.a, contact.b) != key)
+			{
+				m_nextCache.push_back(contact);
+			}
+		}
+
+		if (i < m_contacts.size())
+		{
+			CachedContact contact;
+			contact.a = m_contacts[i].a;
+			contact.b = m_contacts[i].b;
+			contact.normalImpulse = m_contacts[i].normalImpulse;
+			contact.tangentImpulse = m_contacts[i].tangentImpulse;
+			m_nextCache.push_back(contact);
+		}
+	}
+	m_cache.swap(m_nextCache);
+}
+
+void ContactSolver::ApplyImpulse(std::vector<Ball>& balls, const Contact& contact, const glm::vec2& impulse) const
+{
+	balls[contact.a].velocity += impulse * contact.inverseMassA;
+	if ((contact.b & solidBit) == 0u)
+	{
+		balls[contact.b].velocity -= impulse * contact.inverseMassB;
+	}
+}
+
+void ContactSolver::WarmStart(std::vector<Ball>& balls)
+{
+	for (size_t i = 0u; i < m_contacts.size(); ++i)
+	{
+		const Contact& contact = m_contacts[i];
+		ApplyImpulse(balls, contact, contact.normal * contact.normalImpulse + Tangent(contact.normal) * contact.tangentImpulse);
+	}
+}
+
+void ContactSolver::SolveVelocities(std::vector<Ball>& balls)
+{
+	for (size_t i = 0u; i < m_contacts.size(); ++i)
+	{
+		Contact& contact = m_contacts[i];
+		const bool solid = (contact.b & solidBit) != 0u;
+		const glm::vec2 tangent = Tangent(contact.normal);
+
+		//Friction first, limited by the normal impulse of the previous pass
+		glm::vec2 relativeVelocity = balls[contact.a].velocity - (solid ? glm::vec2(0.0f) : balls[contact.b].velocity);
+		const float maxFriction = contact.friction * contact.normalImpulse;
+		const float tangentImpulse = std::min(std::max(contact.tangentImpulse - glm::dot(relativeVelocity, tangent) * contact.normalMass, -maxFriction), maxFriction);
+		ApplyImpulse(balls, contact, tangent * (tangentImpulse - contact.tangentImpulse));
+		contact.tangentImpulse = tangentImpulse;
+
+		//The accumulated normal impulse may shrink again but never pull the bodies together
+		relativeVelocity = balls[contact.a].velocity - (solid ? glm::vec2(0.0f) : balls[contact.b].velocity);
+		const float normalImpulse = std::max(contact.normalImpulse + (contact.bounce - glm::dot(relativeVelocity, contact.normal)) * contact.normalMass, 0.0f);
+		ApplyImpulse(balls, contact, contact.normal * (normalImpulse - contact.normalImpulse));
+		contact.normalImpulse = normalImpulse;
+	}
+}
+
+void ContactSolver::SolvePositions(std::vector<Ball>& balls)
+{
+	//Overlaps are corrected on the positions directly, a bias on the velocities would add energy to the stack.
+	//Every contact tracks its remaining overlap through the corrections its two balls received so far.
+	m_shift.assign(balls.size(), glm::vec2(0.0f));
+
+	for (size_t iteration = 0u; iteration < m_iterations; ++iteration)
+	{
+		for (size_t i = 0u; i < m_contacts.size(); ++i)
+		{
+			const Contact& contact = m_contacts[i];
+			const bool solid = (contact.b & solidBit) != 0u;
+			const glm::vec2 shiftB = solid ? glm::vec2(0.0f) : m_shift[contact.b];
+
+			const float overlap = contact.penetration - glm::dot(m_shift[contact.a] - shiftB, contact.normal);
+			const float correction = (overlap - Config::contactSlop) * Config::contactCorrection;
+			if (correction <= 0.0f)
+			{
+				continue;
+			}
+
+			const glm::vec2 push = contact.normal * (correction * contact.normalMass);
+			const glm::vec2 shiftA = push * contact.inverseMassA;
+			balls[contact.a].position += shiftA;
+			m_shift[contact.a] += shiftA;
+
+			if (!solid)
+			{
+				const glm::vec2 shift = push * contact.inverseMassB;
+				balls[contact.b].position -= shift;
+				m_shift[contact.b] -= shift;
+			}
+		}
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include "Ball.h"
+#include "Config.hpp"
+
+//Sequential impulse solver for the contacts of balls with other balls and with solids.
+//Contacts are keyed by their body pair and keep the impulses they accumulated from one step to the next.
+//A pair that is still touching starts from last steps impulses (warm starting), so a resting stack
+//is already close to its solution and converges in a few iterations instead of bouncing the load around.
+class ContactSolver
+{
+public:
+	//Marks solids in the body b of a contact, balls use their plain index
+	const static uint32_t solidBit = 0x80000000u;
+
+	//Accumulated impulses of one body pair, sorted by a then b. Pairs of sleeping balls stay cached until they wake.
+	struct CachedContact
+	{
+		uint32_t a;
+		uint32_t b;
+		float normalImpulse;
+		float tangentImpulse;
+	};
+
+	ContactSolver();
+
+	//Sizes the buffers for the worst case, so solving never reallocates them
+	void Reserve(size_t ballCount, size_t contactCount);
+	//Drops the cached impulses
+	void Clear();
+	//Keeps the cache valid after the ball at index was removed and all later balls moved down by one
+	void EraseBall(uint32_t ball);
+	//Takes over cached impulses, for instance from a snapshot
+	void Restore(const CachedContact* contacts, size_t count);
+
+	//a is always a ball, the normal points from b towards a and penetration is the overlap along it
+	void AddContact(uint32_t a, uint32_t b, const glm::vec2& normal, float penetration);
+	//Warm starts the contacts added since the last call, solves their velocities and pushes the balls apart.
+	//Balls whose entry in integrated is zero were woken during the collision checks. A pair of two such balls holds still until the next step
+	//so a woken stack does not sag before the contacts below it are found. Pairs that were not added again drop out of the cache.
+	void Solve(std::vector<Ball>& balls, const std::vector<uint8_t>& integrated);
+
+	void SetIterations(size_t iterations) { m_iterations = iterations; }
+	size_t GetIterations() const { return m_iterations; }
+
+	const std::vector<CachedContact>& GetCache() const { return m_cache; }
+	//Contacts of the last Solve that started from cached impulses
+	size_t GetWarmStartCount() const { return m_warmStarted; }
+
+private:
+	struct Contact
+	{
+		uint64_t key;
+		uint32_t a;
+		uint32_t b;
+		glm::vec2 normal;
+		float penetration;
+		float normalImpulse;
+		float tangentImpulse;
+		float inverseMassA;
+		float inverseMassB;
+		float normalMass;
+		float friction;
+		float bounce; //Normal velocity the contact aims for, nonzero only for fast impacts
+	};
+
+	void ApplyImpulse(std::vector<Ball>& balls, const Contact& contact, const glm::vec2& impulse) const;
+	void WarmStart(std::vector<Ball>& balls);
+	void SolveVelocities(std::vector<Ball>& balls);
+	void SolvePositions(std::vector<Ball>& balls);
+	void UpdateCache(const std::vector<Ball>& balls);
+
+	std::vector<Contact> m_contacts;
+	std::vector<CachedContact> m_cache;
+	std::vector<CachedContact> m_nextCache;
+	std::vector<glm::vec2> m_shift; //Position correction every ball received during this Solve
+	size_t m_iterations;
+	size_t m_warmStarted;
+};
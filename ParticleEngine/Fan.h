@@ -1,5 +1,4 @@
 ﻿#pragma once
-#include <SFML/Graphics.hpp>
 #include <glm/glm.hpp>
 #include "Particle.h"
 
@@ -12,8 +11,13 @@ public:
 	Fan(const Fan& other);
 	~Fan();
 
-	void Render(sf::RenderWindow& window);
 	void InfluenceParticle(Particle& particle);
+	void InfluenceParticle(const glm::vec2& particlePosition, glm::vec2& acceleration) const;
+
+	const glm::vec2& GetStart() const { return points[0]; }
+	const glm::vec2& GetEnd() const { return points[1]; }
+	const glm::vec2& GetBlowDirection() const { return blowDirection; }
+	float GetStrength() const { return strength; }
 
 private:
 	//Start and Endpoint
@@ -21,7 +25,4 @@ private:
 	glm::vec2 fanVec;
 	glm::vec2 blowDirection;
 	float strength;
-
-	//Renderstuff
-	sf::VertexArray renderPoints;
 };
@@ -0,0 +1,59 @@
+#include "ForceField.h"
+#include "Config.hpp"
+#include <algorithm>
+#include <cmath>
+
+ForceField::ForceField()
+	: m_origin(0.0f)
+	, m_inverseCellSize(1.0f)
+	, m_maxCoordinate(0.0f)
+	, m_stride(0)
+{
+}
+
+void ForceField::Build(const std::vector<Fan>& fans, const std::vector<Solid>& solids, float cellSize)
+{
+	m_nodes.clear();
+	m_maxCoordinate = glm::vec2(0.0f);
+	m_stride = 0;
+
+	if (fans.empty())
+	{
+		return;
+	}
+
+	//Bodies stay within the window or the solids around it
+	glm::vec2 min(0.0f);
+	glm::vec2 max(static_cast<float>(Config::width), static_cast<float>(Config::height));
+	for (size_t i = 0u; i < solids.size(); ++i)
+	{
+		min = glm::min(min, solids[i].aabb.min);
+		max = glm::max(max, solids[i].aabb.max);
+	}
+	const glm::vec2 extent = max - min;
+
+	cellSize = std::max(cellSize, std::max(extent.x, extent.y) / static_cast<float>(maxCellsPerAxis));
+	const int columns = std::max(static_cast<int>(std::ceil(extent.x / cellSize)), 1);
+	const int rows = std::max(static_cast<int>(std::ceil(extent.y / cellSize)), 1);
+
+	m_origin = min;
+	m_inverseCellSize = 1.0f / cellSize;
+	m_maxCoordinate = glm::vec2(static_cast<float>(columns), static_cast<float>(rows));
+	m_stride = columns + 1;
+
+	//Every corner sums all fans once, the per step cost no longer depends on their number
+	m_nodes.assign(static_cast<size_t>(m_stride * (rows + 1)), glm::vec2(0.0f));
+	for (int y = 0; y <= rows; ++y)
+	{
+		for (int x = 0; x <= columns; ++x)
+		{
+			const glm::vec2 position = m_origin + glm::vec2(static_cast<float>(x), static_cast<float>(y)) * cellSize;
+			glm::vec2& acceleration = m_nodes[y * m_stride + x];
+
+			for (size_t i = 0u; i < fans.size(); ++i)
+			{
+				fans[i].InfluenceParticle(position, acceleration);
+			}
+		}
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include "Fan.h"
+#include "Solid.h"
+
+//Accelerations of the static force sources rasterized into a coarse grid.
+//It is built with the static geometry, afterwards every body takes one bilinear sample per step
+//no matter how many fans the scene holds. Sharp fan borders get blurred over one cell.
+class ForceField
+{
+public:
+	ForceField();
+
+	//Covers the static geometry and the window, bodies outside of it feel no force
+	void Build(const std::vector<Fan>& fans, const std::vector<Solid>& solids, float cellSize);
+
+	glm::vec2 Sample(const glm::vec2& position) const
+	{
+		const float x = (position.x - m_origin.x) * m_inverseCellSize;
+		const float y = (position.y - m_origin.y) * m_inverseCellSize;
+
+		//Also rejects NaN and an empty field
+		if (!(x >= 0.0f && y >= 0.0f && x < m_maxCoordinate.x && y < m_maxCoordinate.y))
+		{
+			return glm::vec2(0.0f);
+		}
+
+		const int cellX = static_cast<int>(x);
+		const int cellY = static_cast<int>(y);
+		const float tx = x - static_cast<float>(cellX);
+		const float ty = y - static_cast<float>(cellY);
+
+		//Values live on the cell corners
+		const glm::vec2* top = &m_nodes[cellY * m_stride + cellX];
+		const glm::vec2* bottom = top + m_stride;
+		const glm::vec2 upper = top[0] + (top[1] - top[0]) * tx;
+		const glm::vec2 lower = bottom[0] + (bottom[1] - bottom[0]) * tx;
+		return upper + (lower - upper) * ty;
+	}
+
+private:
+	const static int maxCellsPerAxis = 256;
+
+	glm::vec2 m_origin;
+	float m_inverseCellSize;
+	glm::vec2 m_maxCoordinate; //Cell count per axis as float, so Sample compares without converting
+	int m_stride;			   //Corners per row, one more than the cells
+
+	std::vector<glm::vec2> m_nodes;
+};
@@ -1,6 +1,8 @@
 #pragma once
 #include "Particle.h"
+#include "ParticleStore.h"
 #include <glm/gtx/projection.hpp>
+#include <cmath>
 
 namespace ForceGenerators
 {
@@ -14,14 +16,6 @@ namespace ForceGenerators
 	const static glm::vec2 g_gravity(0.0f, 9.81f);
 	const static float g_airPressure = 0.99f;
 
-	struct SpringContraint
-	{
-		Particle* p1;
-		Particle* p2;
-		float restLength;
-		float stiffness;
-	};
-
 	static void ApplyGravity(Particle& particle)
 	{
 		particle.acceleration += g_gravity;
@@ -32,37 +26,26 @@ namespace ForceGenerators
 		particle.velocity *= g_airPressure;
 	}
 
-	static void ApplySpringForces(Particle& p1, Particle& p2, float restLength, float stiffness)
-	{
-		glm::vec2 direction = Collisions::saveNormalize(p2.position - p1.position);
-		float currentLength = Collisions::saveDistance(p1.position, p2.position);
-
-		float force = -stiffness * (currentLength - restLength);
-
-		p1.acceleration += force * -direction;
-		p2.acceleration += force * direction;
-	}
-
-	static void ApplyReflexion(Particle& particle, const Collisions::Contact& contact)
+	static void ApplyReflexion(glm::vec2& position, glm::vec2& velocity, glm::vec2& acceleration, const ParticleMaterial& material, const Collisions::Contact& contact)
 	{
-		particle.position += (contact.penetration + 0.5f) * contact.contactNormal;
+		position += (contact.penetration + 0.5f) * contact.contactNormal;
 
-		glm::vec2 relativeAcceleration = -((1.0f + particle.bounciness) * glm::dot(particle.velocity, contact.contactNormal)) * contact.contactNormal;
+		glm::vec2 relativeAcceleration = -((1.0f + material.bounciness) * glm::dot(velocity, contact.contactNormal)) * contact.contactNormal;
 
-		particle.acceleration += relativeAcceleration;
+		acceleration += relativeAcceleration;
 
-		glm::vec2 normalVelocity = glm::proj(particle.velocity, -contact.contactNormal);
+		glm::vec2 normalVelocity = glm::proj(velocity, -contact.contactNormal);
 		if (Collisions::saveLength(normalVelocity) > 100.0f)
 		{
 			return;
 		}
 
-		glm::vec2 relativeVelocity = glm::vec2(0.0f) - particle.velocity;
+		glm::vec2 relativeVelocity = glm::vec2(0.0f) - velocity;
 		float velocityAlongNormal = glm::dot(relativeVelocity, contact.contactNormal);
 
-		float j = -(1 + particle.bounciness) * velocityAlongNormal;
+		float j = -(1 + material.bounciness) * velocityAlongNormal;
 
-		relativeVelocity = glm::vec2(0.0f) - particle.velocity;
+		relativeVelocity = glm::vec2(0.0f) - velocity;
 		glm::vec2 tangent;
 		if (relativeVelocity.x * contact.contactNormal.y - relativeVelocity.y * contact.contactNormal.x < 0.0f)
 		{
@@ -77,7 +60,7 @@ namespace ForceGenerators
 
 		// clamp friction and differentiate between static and kinetic friction
 		glm::vec2 frictionImpulse;
-		if (abs(jt) < j * particle.staticFriction)
+		if (std::abs(jt) < j * material.staticFriction)
 		{
 			// static friction
 			frictionImpulse = jt * tangent;
@@ -85,10 +68,27 @@ namespace ForceGenerators
 		else
 		{
 			// kinematic friction
-			frictionImpulse = -j * tangent * particle.kinematicFriction;
+			frictionImpulse = -j * tangent * material.kinematicFriction;
 		}
 
-		particle.velocity +=/* particle->inverseMass **/ frictionImpulse;
+		velocity +=/* material.inverseMass **/ frictionImpulse;
+	}
+
+	static void ApplyReflexion(Particle& particle, const Collisions::Contact& contact)
+	{
+		ParticleMaterial material;
+		material.mass = particle.mass;
+		material.inverseMass = particle.inverseMass;
+		material.bounciness = particle.bounciness;
+		material.staticFriction = particle.staticFriction;
+		material.kinematicFriction = particle.kinematicFriction;
+
+		ApplyReflexion(particle.position, particle.velocity, particle.acceleration, material, contact);
+	}
+
+	static void ApplyReflexion(ParticleStore& store, const Collisions::Contact& contact)
+	{
+		ApplyReflexion(store.Positions()[contact.index], store.Velocities()[contact.index], store.Accelerations()[contact.index], store.material, contact);
 	}
 
 	static void ResolveCollision(Particle& p1, Particle& p2, const Collisions::Contact& contact)
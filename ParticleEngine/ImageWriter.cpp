@@ -0,0 +1,157 @@
+#include "ImageWriter.h"
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+namespace
+{
+	const size_t maxStoredBlock = 65535u;
+
+	//Largest run of bytes the Adler-32 sums can take before they have to be reduced
+	const size_t adlerBlock = 5552u;
+
+	struct CrcTable
+	{
+		CrcTable()
+		{
+			for (uint32_t i = 0u; i < 256u; ++i)
+			{
+				uint32_t c = i;
+				for (int k = 0; k < 8; ++k)
+				{
+					c = (c & 1u) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				}
+				values[i] = c;
+			}
+		}
+
+		uint32_t values[256];
+	};
+
+	uint32_t Crc32(uint32_t crc, const uint8_t* data, size_t size)
+	{
+		static const CrcTable table;
+
+		crc = ~crc;
+		for (size_t i = 0u; i < size; ++i)
+		{
+			crc = table.values[(crc ^ data[i]) & 0xFFu] ^ (crc >> 8);
+		}
+		return ~crc;
+	}
+
+	uint32_t Adler32(const uint8_t* data, size_t size)
+	{
+		uint32_t a = 1u;
+		uint32_t b = 0u;
+
+		for (size_t offset = 0u; offset < size; offset += adlerBlock)
+		{
+			const size_t end = std::min(offset + adlerBlock, size);
+			for (size_t i = offset; i < end; ++i)
+			{
+				a += data[i];
+				b += a;
+			}
+			a %= 65521u;
+			b %= 65521u;
+		}
+
+		return (b << 16) | a;
+	}
+
+	void PutBigEndian(std::vector<uint8_t>& out, uint32_t value)
+	{
+		out.push_back(static_cast<uint8_t>(value >> 24));
+		out.push_back(static_cast<uint8_t>(value >> 16));
+		out.push_back(static_cast<uint8_t>(value >> 8));
+		out.push_back(static_cast<uint8_t>(value));
+	}
+
+	//Length, type, data and the CRC over type and data
+	bool WriteChunk(FILE* file, const char* type, const std::vector<uint8_t>& data)
+	{
+		std::vector<uint8_t> header;
+		PutBigEndian(header, static_cast<uint32_t>(data.size()));
+		header.insert(header.end(), type, type + 4);
+
+		uint32_t crc = Crc32(0u, &header[4], 4u);
+		if (!data.empty())
+		{
+			crc = Crc32(crc, &data[0], data.size());
+		}
+
+		std::vector<uint8_t> footer;
+		PutBigEndian(footer, crc);
+
+		return std::fwrite(&header[0], 1u, header.size(), file) == header.size()
+			&& (data.empty() || std::fwrite(&data[0], 1u, data.size(), file) == data.size())
+			&& std::fwrite(&footer[0], 1u, footer.size(), file) == footer.size();
+	}
+}
+
+bool ImageWriter::WritePng(const char* path, const uint8_t* rgba, size_t width, size_t height)
+{
+	if (width == 0u || height == 0u)
+	{
+		return false;
+	}
+
+	//Every scanline starts with filter type 0, no filtering
+	const size_t rowSize = width * 4u;
+	std::vector<uint8_t> raw(height * (rowSize + 1u));
+	for (size_t y = 0u; y < height; ++y)
+	{
+		raw[y * (rowSize + 1u)] = 0u;
+		std::memcpy(&raw[y * (rowSize + 1u) + 1u], rgba + y * rowSize, rowSize);
+	}
+
+	//zlib stream of stored blocks
+	std::vector<uint8_t> idat;
+	idat.reserve(raw.size() + (raw.size() / maxStoredBlock + 1u) * 5u + 6u);
+	idat.push_back(0x78u);
+	idat.push_back(0x01u);
+
+	for (size_t offset = 0u; offset < raw.size(); offset += maxStoredBlock)
+	{
+		const size_t size = std::min(maxStoredBlock, raw.size() - offset);
+		const bool last = offset + size == raw.size();
+
+		idat.push_back(last ? 1u : 0u);
+		idat.push_back(static_cast<uint8_t>(size));
+		idat.push_back(static_cast<uint8_t>(size >> 8));
+		idat.push_back(static_cast<uint8_t>(~size));
+		idat.push_back(static_cast<uint8_t>(~size >> 8));
+		idat.insert(idat.end(), raw.begin() + offset, raw.begin() + offset + size);
+	}
+	PutBigEndian(idat, Adler32(&raw[0], raw.size()));
+
+	std::vector<uint8_t> ihdr;
+	PutBigEndian(ihdr, static_cast<uint32_t>(width));
+	PutBigEndian(ihdr, static_cast<uint32_t>(height));
+	ihdr.push_back(8u); //Bit depth
+	ihdr.push_back(6u); //Truecolor with alpha
+	ihdr.push_back(0u); //Deflate
+	ihdr.push_back(0u); //Adaptive filtering
+	ihdr.push_back(0u); //No interlace
+
+	FILE* file = std::fopen(path, "wb");
+	if (!file)
+	{
+		return false;
+	}
+
+	const uint8_t signature[8] = { 0x89u, 'P', 'N', 'G', '\r', '\n', 0x1Au, '\n' };
+	bool written = std::fwrite(signature, 1u, sizeof(signature), file) == sizeof(signature);
+	written = written && WriteChunk(file, "IHDR", ihdr);
+	written = written && WriteChunk(file, "IDAT", idat);
+	written = written && WriteChunk(file, "IEND", std::vector<uint8_t>());
+
+	return std::fclose(file) == 0 && written;
+}
+
+bool ImageWriter::WriteRaw(FILE* file, const uint8_t* rgba, size_t width, size_t height)
+{
+	const size_t size = width * height * 4u;
+	return file && std::fwrite(rgba, 1u, size, file) == size;
+}
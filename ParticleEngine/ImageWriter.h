@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+
+//Dependency free image output for the software renderer.
+//Pixels are 8 bit RGBA, rows from top to bottom without padding.
+namespace ImageWriter
+{
+	//Uncompressed deflate blocks inside the zlib stream, so no compression library is needed.
+	//The files are large, but writing them costs little more than the memcpy.
+	bool WritePng(const char* path, const uint8_t* rgba, size_t width, size_t height);
+
+	//Appends the frame as is, a sequence of them plays with ffmpeg -f rawvideo -pix_fmt rgba -s WxH
+	bool WriteRaw(FILE* file, const uint8_t* rgba, size_t width, size_t height);
+}
@@ -0,0 +1,166 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+
+JobSystem::JobSystem(size_t workerCount)
+	: m_workerCount(workerCount)
+	, m_function(nullptr)
+	, m_job(nullptr)
+	, m_remaining(0u)
+	, m_generation(0u)
+	, m_running(true)
+{
+	if (m_workerCount == 0u)
+	{
+		m_workerCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (size_t i = 0u; i < m_workerCount; ++i)
+	{
+		m_queues.push_back(std::unique_ptr<Queue>(new Queue()));
+	}
+
+	//Worker 0 is the thread calling ParallelFor
+	for (size_t i = 1u; i < m_workerCount; ++i)
+	{
+		m_threads.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_running = false;
+	}
+	m_wake.notify_all();
+
+	for (size_t i = 0u; i < m_threads.size(); ++i)
+	{
+		m_threads[i].join();
+	}
+}
+
+void JobSystem::Dispatch(size_t count, size_t chunkSize, ChunkFunction function, const void* job)
+{
+	if (count == 0u)
+	{
+		return;
+	}
+
+	chunkSize = std::max<size_t>(chunkSize, 1u);
+	const size_t chunkCount = (count + chunkSize - 1u) / chunkSize;
+
+	//Nothing to share, skip the queues entirely
+	if (m_workerCount == 1u || chunkCount == 1u)
+	{
+		for (size_t begin = 0u; begin < count; begin += chunkSize)
+		{
+			function(job, begin, std::min(begin + chunkSize, count), 0u);
+		}
+		return;
+	}
+
+	m_function = function;
+	m_job = job;
+	m_remaining.store(chunkCount);
+
+	//Neighbouring chunks go to the same worker, stealing only kicks in once a worker falls behind
+	for (size_t c = 0u; c < chunkCount; ++c)
+	{
+		Task task;
+		task.begin = c * chunkSize;
+		task.end = std::min(task.begin + chunkSize, count);
+
+		Queue& queue = *m_queues[(c * m_workerCount) / chunkCount];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(task);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		++m_generation;
+	}
+	m_wake.notify_all();
+
+	while (m_remaining.load() > 0u)
+	{
+		if (!RunOne(0u))
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::WorkerLoop(size_t worker)
+{
+	size_t seenGeneration = 0u;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_wakeMutex);
+			m_wake.wait(lock, [&]() { return !m_running || m_generation != seenGeneration; });
+
+			if (!m_running)
+			{
+				return;
+			}
+			seenGeneration = m_generation;
+		}
+
+		while (RunOne(worker))
+		{
+		}
+	}
+}
+
+bool JobSystem::RunOne(size_t worker)
+{
+	Task task;
+	if (!Pop(worker, task) && !Steal(worker, task))
+	{
+		return false;
+	}
+
+	{
+		Profiler::ScopedTimer timer("Job");
+		m_function(m_job, task.begin, task.end, worker);
+	}
+	m_remaining.fetch_sub(1u);
+
+	return true;
+}
+
+bool JobSystem::Pop(size_t worker, Task& task)
+{
+	Queue& queue = *m_queues[worker];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+
+	if (queue.tasks.empty())
+	{
+		return false;
+	}
+
+	task = queue.tasks.back();
+	queue.tasks.pop_back();
+	return true;
+}
+
+bool JobSystem::Steal(size_t worker, Task& task)
+{
+	for (size_t i = 1u; i < m_workerCount; ++i)
+	{
+		Queue& queue = *m_queues[(worker + i) % m_workerCount];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (!queue.tasks.empty())
+		{
+			task = queue.tasks.front();
+			queue.tasks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
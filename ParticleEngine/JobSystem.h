@@ -0,0 +1,73 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+//Fork join scheduler with one task queue per worker.
+//Workers drain their own queue from the back and steal from the front of the others once it runs dry.
+//The thread calling ParallelFor works as worker 0 and only returns once every chunk is done,
+//which makes each call a barrier between dependent phases.
+class JobSystem
+{
+public:
+	//workerCount includes the calling thread, 0 uses every hardware thread
+	explicit JobSystem(size_t workerCount = 0u);
+	~JobSystem();
+
+	size_t GetWorkerCount() const { return m_workerCount; }
+
+	//Runs job(begin, end, worker) over [0, count) in chunks of chunkSize
+	template<typename Job>
+	void ParallelFor(size_t count, size_t chunkSize, const Job& job)
+	{
+		Dispatch(count, chunkSize, &Invoke<Job>, &job);
+	}
+
+private:
+	typedef void(*ChunkFunction)(const void* job, size_t begin, size_t end, size_t worker);
+
+	struct Task
+	{
+		size_t begin;
+		size_t end;
+	};
+
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	JobSystem(const JobSystem& other);
+	JobSystem& operator=(const JobSystem& other);
+
+	template<typename Job>
+	static void Invoke(const void* job, size_t begin, size_t end, size_t worker)
+	{
+		(*static_cast<const Job*>(job))(begin, end, worker);
+	}
+
+	void Dispatch(size_t count, size_t chunkSize, ChunkFunction function, const void* job);
+	void WorkerLoop(size_t worker);
+	bool RunOne(size_t worker);
+	bool Pop(size_t worker, Task& task);
+	bool Steal(size_t worker, Task& task);
+
+	size_t m_workerCount;
+	std::vector<std::thread> m_threads;
+	std::vector<std::unique_ptr<Queue>> m_queues;
+
+	//The batch currently being dispatched
+	ChunkFunction m_function;
+	const void* m_job;
+	std::atomic<size_t> m_remaining;
+
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wake;
+	size_t m_generation;
+	bool m_running;
+};
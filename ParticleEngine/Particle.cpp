@@ -12,7 +12,6 @@ Particle::Particle()
 	acceleration.y = 0.0f;
 	mass = 1.0f;
 	bounciness = 0.25f;
-	toBeDeleted = false;
 	inverseMass = 1.0f / mass;
 	staticFriction = 0.9f;
 	kinematicFriction = 0.7f;
@@ -26,7 +25,6 @@ Particle::Particle(const Particle& other)
 	velocity = other.velocity;
 	acceleration = other.acceleration;
 	bounciness = other.bounciness;
-	toBeDeleted = other.toBeDeleted;
 	inverseMass = other.inverseMass;
 	staticFriction = other.staticFriction;
 	kinematicFriction = other.kinematicFriction;
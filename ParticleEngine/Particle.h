@@ -16,7 +16,6 @@ struct Particle
 	float mass;
 	float inverseMass;
 	float bounciness;
-	bool toBeDeleted : 1;
 	float staticFriction;
 	float kinematicFriction;
 };
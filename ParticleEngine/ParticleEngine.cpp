@@ -1,234 +1,361 @@
 ﻿#include "ParticleEngine.h"
 #include "ForceGenerators.hpp"
 #include "Config.hpp"
+#include "ParticleKernels.h"
+#include "ParticlePipeline.h"
+#include "Profiler.h"
+#include "Snapshot.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+	Snapshot::BodyRecord ToRecord(const Ball& ball)
+	{
+		Snapshot::BodyRecord record;
+		record.oldPosition = ball.oldPosition;
+		record.position = ball.position;
+		record.velocity = ball.velocity;
+		record.acceleration = ball.acceleration;
+		record.mass = ball.mass;
+		record.inverseMass = ball.inverseMass;
+		record.bounciness = ball.bounciness;
+		record.staticFriction = ball.staticFriction;
+		record.kinematicFriction = ball.kinematicFriction;
+		record.radius = ball.radius;
+		record.sleeping = ball.sleeping ? 1u : 0u;
+		record.restSteps = static_cast<uint32_t>(ball.restSteps);
+		return record;
+	}
+
+	Ball FromRecord(const Snapshot::BodyRecord& record)
+	{
+		Ball ball;
+		ball.oldPosition = record.oldPosition;
+		ball.position = record.position;
+		ball.velocity = record.velocity;
+		ball.acceleration = record.acceleration;
+		ball.mass = record.mass;
+		ball.inverseMass = record.inverseMass;
+		ball.bounciness = record.bounciness;
+		ball.staticFriction = record.staticFriction;
+		ball.kinematicFriction = record.kinematicFriction;
+		ball.radius = record.radius;
+		ball.sleeping = record.sleeping != 0u;
+		ball.restSteps = record.restSteps;
+		return ball;
+	}
+
+	std::vector<Snapshot::BodyRecord> ToRecords(const std::vector<Ball>& balls)
+	{
+		std::vector<Snapshot::BodyRecord> records(balls.size());
+		for (size_t i = 0u; i < balls.size(); ++i)
+		{
+			records[i] = ToRecord(balls[i]);
+		}
+		return records;
+	}
+
+	ParticleKernels::Forces EnvironmentForces()
+	{
+		ParticleKernels::Forces forces;
+		forces.gravity = ForceGenerators::g_gravity;
+		forces.drag = ForceGenerators::g_airPressure;
+		return forces;
+	}
+
+	//Oldest particle first, a wrapped ring is stored as its two halves
+	template<typename T>
+	void SetRingArray(Snapshot::Writer& writer, Snapshot::ArrayId id, const T* data, const ParticleStore& store)
+	{
+		writer.SetArray(id, sizeof(T), data + store.Head(), store.Size() - store.Head(), data, store.Head());
+	}
+}
 
 ParticleEngine::ParticleEngine()
+	: ParticleEngine(SceneDescription::Default())
 {
-	//Setting up Solid geometry
-	Solid centerPlatform;
-	centerPlatform.SetSize(sf::Vector2f((float)Config::width * 0.3f, (float)Config::height * 0.05f));
-	centerPlatform.SetRotation(15.0f);
-	centerPlatform.SetPosition(sf::Vector2f((float)Config::width * 0.5f, (float)Config::height * 0.5f));
-	m_solids.push_back(centerPlatform);
-
-	//BottemLeft Platform
-	Solid leftBottomPlatform;
-	leftBottomPlatform.SetSize(sf::Vector2f((float)Config::width * 0.3f, (float)Config::height * 0.4f));
-	leftBottomPlatform.SetRotation(45.0f);
-	leftBottomPlatform.SetPosition(sf::Vector2f((float)Config::width * 0.0f, (float)Config::height));
-	m_solids.push_back(leftBottomPlatform);
-
-	//Left Wall
-	Solid wall; 
-	wall.SetSize(sf::Vector2f((float)Config::width* 0.45f, (float)Config::height));
-	wall.SetPosition(sf::Vector2f((float)Config::width * -0.2f, (float)Config::height * 0.50f));
-	m_solids.push_back(wall);
-
-	//Right Wall
-	wall.SetPosition(sf::Vector2f((float)Config::width * 1.2f, (float)Config::height * 0.50f));
-	m_solids.push_back(wall);
-
-	//floor
-	Solid floor;
-	floor.SetSize(sf::Vector2f((float)Config::width, (float)Config::height * 0.45f));
-	floor.SetPosition(sf::Vector2f((float)Config::width * 0.5f, (float)Config::height * 1.2f));
-	m_solids.push_back(floor);
-
-	//ceiling
-	floor.SetPosition(sf::Vector2f((float)Config::width * 0.5f, (float)Config::height * -0.2f));
-	m_solids.push_back(floor);
-
-	//Setting up blizzards
-	Blizzard blizzard1(glm::vec2((float)Config::width * 0.75f, (float)Config::height * 0.25f), 25);
-	m_blizzards.push_back(blizzard1);
-
-	Blizzard blizzard2(glm::vec2((float)Config::width * 0.25f, (float)Config::height * 0.25f), 25);
-	m_blizzards.push_back(blizzard2);
-
-	//Setting Up BallGenerator
-	BallGenerator ballGen1(glm::vec2((float)Config::width * 0.25f, (float)Config::height * 0.15f), glm::vec2((float)Config::width * 0.75f, (float)Config::height * 0.15f), 10.0f);
-	m_ballGenerators.push_back(ballGen1);
-
-	//Setting up Fans
-	Fan fan1(glm::vec2((float)Config::width * 0.95f, (float)Config::height * 0.15f), glm::vec2((float)Config::width * 0.95f, (float)Config::height * 0.35f), 10.0f);
-	m_fans.push_back(fan1);
-
-	Fan fan2(glm::vec2((float)Config::width * 0.95f, (float)Config::height * 0.99f), glm::vec2((float)Config::width * 0.75f, (float)Config::height * 0.99f), 20.0f);
-	m_fans.push_back(fan2);
-
-	m_particleVertices.reserve(Config::maxParticleCount);
-	m_particles.reserve(Config::maxParticleCount);
-	m_particleReflexions.reserve(Config::maxParticleCount);
-	m_ballReflexions.reserve(Config::maxBallCount * m_solids.size());
-	m_particleCollisions.reserve(Config::maxBallCount * Config::maxBallCount + Config::clothColumns * Config::clothRows);
-	m_clothReflexions.reserve(Config::clothColumns * Config::clothRows);
-
-	//Setting Up Rendering Stuff
-	renderCircle.setPointCount(15);
-	renderCircle.setRadius(1.0f);
-	renderCircle.setOrigin(renderCircle.getRadius(), renderCircle.getRadius());
-	renderCircle.setOutlineThickness(1.0f / Config::ballSize);
-	renderCircle.setOutlineColor(sf::Color::Yellow);
-	renderCircle.setFillColor(sf::Color::Transparent);
-
-	GenerateCloth(10.0f, glm::vec2((float)Config::width * 0.15f, (float)Config::height * 0.45f), 5.0f);
+}
+
+ParticleEngine::ParticleEngine(const SceneDescription& scene)
+	: ParticleEngine(scene.particleCapacity, scene.ballCapacity)
+{
+	m_particles.SetCapacityMode(scene.particleCapacityMode);
+	LoadScene(scene);
+}
+
+ParticleEngine::ParticleEngine(size_t particleCapacity, size_t ballCapacity)
+	: m_ballCapacity(ballCapacity)
+	, m_clothColumns(0u)
+	, m_staticGeometryDirty(true)
+	, m_sweepDistanceSquared(std::numeric_limits<float>::max())
+	, m_staticRevision(0u)
+	, m_randomSeed(0u)
+	, m_sleepingParticles(0u)
+	, m_sleepingBalls(0u)
+	, m_accumulator(0.0f)
+	, m_interpolationAlpha(1.0f)
+	, m_droppedTime(0.0)
+	, m_jobs(Config::workerCount)
+{
+	m_particles.Reserve(particleCapacity);
+	m_balls.reserve(ballCapacity);
+	m_workerScratch.resize(m_jobs.GetWorkerCount());
 }
 
 ParticleEngine::~ParticleEngine()
 {
 }
 
-void ParticleEngine::Update(float deltaTime)
+void ParticleEngine::LoadScene(const SceneDescription& scene)
 {
-	for (size_t i = 0u; i < m_blizzards.size(); ++i)
+	//Every pool grows once for the whole scene instead of once per body
+	m_solids.reserve(m_solids.size() + scene.solids.size());
+	m_blizzards.reserve(m_blizzards.size() + scene.blizzards.size());
+	m_ballGenerators.reserve(m_ballGenerators.size() + scene.ballGenerators.size());
+	m_fans.reserve(m_fans.size() + scene.fans.size());
+
+	for (size_t i = 0u; i < scene.solids.size(); ++i)
 	{
-		m_blizzards[i].Update(deltaTime, *this);
+		m_solids.push_back(scene.solids[i]);
 	}
+	m_staticGeometryDirty = true;
+	++m_staticRevision;
+	WakeAll();
 
-	for (size_t i = 0u; i < m_ballGenerators.size(); ++i)
+	for (size_t i = 0u; i < scene.blizzards.size(); ++i)
+	{
+		AddBlizzard(scene.blizzards[i]);
+	}
+
+	for (size_t i = 0u; i < scene.ballGenerators.size(); ++i)
+	{
+		AddBallGenerator(scene.ballGenerators[i]);
+	}
+
+	for (size_t i = 0u; i < scene.fans.size(); ++i)
 	{
-		m_ballGenerators[i].Update(deltaTime, *this);
+		AddFan(scene.fans[i]);
 	}
 
-	ApplyForces();
-	Integrate(deltaTime);
-	CheckCollisions();
-	ResolveCollisions();
-	DeleteParticles();
+	if (!scene.cloth.empty())
+	{
+		const SceneDescription::Cloth& cloth = scene.cloth.front();
+		SetCloth(cloth.columns, cloth.rows, cloth.nodeRadius, cloth.position, cloth.spacing);
+	}
+
+	SeedRandom(scene.seed);
+	ReserveContactBuffers();
+}
+
+void ParticleEngine::LoadDefaultScene()
+{
+	LoadScene(SceneDescription::Default());
 }
 
-void ParticleEngine::Render(sf::RenderWindow& window)
+void ParticleEngine::AddSolid(const Solid& solid)
 {
-	for (size_t i = 0u; i < m_solids.size(); ++i)
+	m_solids.push_back(solid);
+	ReserveContactBuffers();
+	m_staticGeometryDirty = true;
+	++m_staticRevision;
+
+	//Whatever rested on the old geometry may not be supported anymore
+	WakeAll();
+}
+
+void ParticleEngine::AddBlizzard(const Blizzard& blizzard)
+{
+	m_blizzards.push_back(blizzard);
+}
+
+void ParticleEngine::AddBallGenerator(const BallGenerator& generator)
+{
+	m_ballGenerators.push_back(generator);
+	m_ballGenerators.back().Seed(m_randomSeed, m_ballGenerators.size() - 1u);
+	++m_staticRevision;
+}
+
+void ParticleEngine::AddFan(const Fan& fan)
+{
+	m_fans.push_back(fan);
+	m_staticGeometryDirty = true;
+	++m_staticRevision;
+}
+
+void ParticleEngine::SeedRandom(uint64_t seed)
+{
+	m_randomSeed = seed;
+
+	for (size_t i = 0u; i < m_ballGenerators.size(); ++i)
 	{
-		m_solids[i].Render(window);
+		m_ballGenerators[i].Seed(seed, i);
 	}
+}
+
+void ParticleEngine::Update(float deltaTime)
+{
+	Profiler::ScopedTimer updateTimer("Update");
 
-	for (size_t i = 0u; i < m_blizzards.size(); ++i)
 	{
-		m_blizzards[i].DebugRender(window);
+		Profiler::ScopedTimer timer("Emitters", &m_phaseTimings.emitters);
+
+		for (size_t i = 0u; i < m_blizzards.size(); ++i)
+		{
+			m_blizzards[i].Update(deltaTime, *this);
+		}
+
+		for (size_t i = 0u; i < m_ballGenerators.size(); ++i)
+		{
+			m_ballGenerators[i].Update(deltaTime, *this);
+		}
 	}
 
-	for (size_t i = 0u; i < m_fans.size(); ++i)
 	{
-		m_fans[i].Render(window);
+		Profiler::ScopedTimer timer("IntegrateBodies", &m_phaseTimings.integrateBodies);
+		Integrate(deltaTime);
 	}
 
-	for (size_t i = 0u; i < m_ballGenerators.size(); ++i)
 	{
-		m_ballGenerators[i].Render(window);
+		Profiler::ScopedTimer timer("SolveCloth", &m_phaseTimings.solveCloth);
+		m_clothSolver.Solve(m_cloth, deltaTime, m_jobs);
 	}
 
-	//Cloth
-	for (size_t i = Config::clothColumns; i < m_cloth.size(); ++i)
 	{
-		renderCircle.setPosition(m_cloth[i].position.x, m_cloth[i].position.y);
-		renderCircle.setScale(m_cloth[i].radius, m_cloth[i].radius);
-		window.draw(renderCircle);
+		Profiler::ScopedTimer timer("ParticlePipeline", &m_phaseTimings.particlePipeline);
+		UpdateParticles(deltaTime);
 	}
-	
-	//Springs
-	for(size_t i = 0u; i < m_springs.size(); ++i)
+
 	{
-		m_springVertices[i*2].position.x = m_springs[i].p1->position.x;
-		m_springVertices[i*2].position.y = m_springs[i].p1->position.y;
-		m_springVertices[i*2+1].position.x = m_springs[i].p2->position.x;
-		m_springVertices[i*2+1].position.y = m_springs[i].p2->position.y;
+		Profiler::ScopedTimer timer("CheckCollisions", &m_phaseTimings.checkCollisions);
+		CheckCollisions();
 	}
 
-	window.draw(&m_springVertices[0], m_springVertices.size(), sf::PrimitiveType::Lines);
-
-	//Balls
-	for (size_t i = 0u; i < m_balls.size(); ++i)
 	{
-		renderCircle.setPosition(m_balls[i].position.x, m_balls[i].position.y);
-		renderCircle.setScale(m_balls[i].radius, m_balls[i].radius);
-		window.draw(renderCircle);
+		Profiler::ScopedTimer timer("ResolveCollisions", &m_phaseTimings.resolveCollisions);
+		ResolveCollisions();
 	}
 
-	//Particles
-	for (size_t i = 0u; i < m_particles.size(); ++i)
 	{
-		m_particleVertices[i].position.x = m_particles[i].position.x;
-		m_particleVertices[i].position.y = m_particles[i].position.y;
+		Profiler::ScopedTimer timer("DeleteParticles", &m_phaseTimings.deleteParticles);
+		DeleteParticles();
 	}
 
-	if(!m_particleVertices.empty())
 	{
-		window.draw(&m_particleVertices[0], m_particleVertices.size(), sf::PrimitiveType::Points);
+		Profiler::ScopedTimer timer("UpdateSleep", &m_phaseTimings.updateSleep);
+		UpdateSleep(deltaTime);
 	}
 }
 
-void ParticleEngine::AddParticle(const Particle& particle)
+size_t ParticleEngine::Advance(float frameTime, float fixedStep, size_t maxSubsteps)
 {
-	if(m_particles.size() + 1 > Config::maxParticleCount)
+	m_accumulator += std::max(frameTime, 0.0f);
+
+	size_t steps = 0u;
+	while (m_accumulator >= fixedStep && steps < maxSubsteps)
 	{
-		m_particles.erase(m_particles.begin());
+		Update(fixedStep);
+		m_accumulator -= fixedStep;
+		++steps;
 	}
 
-	if (m_particleVertices.size() + 1 > Config::maxParticleCount)
+	//Spiral of death guard, the simulation slows down instead of falling further behind
+	if (m_accumulator >= fixedStep)
 	{
-		m_particleVertices.erase(m_particleVertices.begin());
+		const float dropped = m_accumulator - std::fmod(m_accumulator, fixedStep);
+		m_droppedTime += dropped;
+		m_accumulator -= dropped;
 	}
 
-	m_particles.push_back(particle);
-
-	sf::Vertex vertex;
-	vertex.position.x = particle.position.x;
-	vertex.position.y = particle.position.y;
-	vertex.color = sf::Color::White;
+	m_interpolationAlpha = m_accumulator / fixedStep;
+	return steps;
+}
 
-	m_particleVertices.push_back(vertex);
+void ParticleEngine::AddParticle(const glm::vec2& position, const glm::vec2& velocity)
+{
+	//A full store recycles the slot of its oldest particle
+	m_particles.Add(position, velocity);
 }
 
 void ParticleEngine::AddBall(const Ball& ball)
 {
-	if (m_balls.size() + 1 > Config::maxBallCount)
+	if (m_ballCapacity == 0u)
+	{
+		return;
+	}
+
+	if (m_balls.size() + 1 > m_ballCapacity)
 	{
+		//Sleeping balls and particles may rest on the evicted ball, their islands would keep them hanging in the air
+		WakeAll();
 		m_balls.erase(m_balls.begin());
+		m_contactSolver.EraseBall(0u);
 	}
 
 	m_balls.push_back(ball);
+	//A new ball has not moved yet, interpolation must not drag it in from the origin
+	m_balls.back().oldPosition = ball.position;
 }
 
-void ParticleEngine::GetInput(const sf::Event::MouseButtonEvent& e)
+void ParticleEngine::SpawnBall(const glm::vec2& position)
 {
-	if(e.button == sf::Mouse::Button::Left)
-	{
-		Ball b1;
-		b1.position = glm::vec2((float)e.x, (float)e.y);
-		AddBall(b1);
-	}
+	Ball ball;
+	ball.position = position;
+	AddBall(ball);
 }
 
-void ParticleEngine::AddSpringContraint(size_t p1Index, size_t p2Index)
+void ParticleEngine::AddClothConstraint(size_t p1Index, size_t p2Index)
 {
 	if(p2Index < m_cloth.size())
 	{
-		ForceGenerators::SpringContraint s;
-		s.p1 = &m_cloth[p1Index];
-		s.p2 = &m_cloth[p2Index];
-		s.restLength = Collisions::saveDistance(m_cloth[p1Index].position, m_cloth[p2Index].position);
-		s.stiffness = 2.0f;
-		m_springs.push_back(s);
+		const float restLength = Collisions::saveDistance(m_cloth[p1Index].position, m_cloth[p2Index].position);
+		m_clothSolver.AddConstraint(static_cast<uint32_t>(p1Index), static_cast<uint32_t>(p2Index), restLength);
 	}
 }
 
+//Contact buffers sized for the worst case of the current budgets, so stepping never reallocates them
+void ParticleEngine::ReserveContactBuffers()
+{
+	m_ballReflexions.reserve(m_ballCapacity);
+	m_contactSolver.Reserve(m_ballCapacity, m_ballCapacity * (m_solids.size() + 3u));
+	m_clothReflexions.reserve(m_cloth.size() * m_solids.size());
+	m_ballContact.reserve(m_ballCapacity);
+	m_ballIntegrated.reserve(m_ballCapacity);
+	m_islandParent.reserve(m_ballCapacity);
+	m_islandRestSteps.reserve(m_ballCapacity);
+
+	//Equal circles touch at most six others, so each body reports at most three pairs
+	m_ballContactPairs.reserve(m_ballCapacity * 3u);
+	m_particleCollisions.reserve((m_ballCapacity + m_cloth.size()) * 3u);
+}
 
-void ParticleEngine::GenerateCloth(const float ballRadius, const glm::vec2& startPosition, float spacing)
+void ParticleEngine::SetClothStiffness(size_t iterations, float compliance)
 {
-	m_cloth.reserve(Config::clothColumns * Config::clothRows);
+	m_clothSolver.SetIterations(iterations);
+	m_clothSolver.SetCompliance(compliance);
+}
+
+
+void ParticleEngine::SetCloth(size_t columns, size_t rows, float nodeRadius, const glm::vec2& startPosition, float spacing)
+{
+	m_clothSolver.Clear();
+	m_cloth.clear();
+	m_cloth.reserve(columns * rows);
+	m_clothColumns = columns;
+
 	glm::vec2 currentPosition = startPosition;
 
-	spacing += ballRadius * 2.0f;
+	spacing += nodeRadius * 2.0f;
 
-	for(size_t i = 0u; i < Config::clothRows; ++i)
+	for(size_t i = 0u; i < rows; ++i)
 	{
-		for (size_t j = 0u; j < Config::clothColumns; ++j)
+		for (size_t j = 0u; j < columns; ++j)
 		{
 			Ball b;
-			b.radius = ballRadius;
+			b.radius = nodeRadius;
 			b.position = currentPosition;
+			b.oldPosition = currentPosition;
 			m_cloth.push_back(b);
 
 			currentPosition.x += spacing;
@@ -241,241 +368,768 @@ void ParticleEngine::GenerateCloth(const float ballRadius, const glm::vec2& star
 	for(size_t i = 0u; i < m_cloth.size(); ++i)
 	{
 
-		if(((int)i + 1) % (int)Config::clothColumns != 0)
+		if((i + 1u) % columns != 0u)
 		{
 			//Right Neighbor
-			AddSpringContraint(i, i + 1);
+			AddClothConstraint(i, i + 1);
 		}
 		
 		//Bottom Neighbor
-		AddSpringContraint(i, i + Config::clothColumns);
+		AddClothConstraint(i, i + columns);
 	}
 
-	m_springVertices.resize(m_springs.size() * 2);
+	//The top row is pinned
+	m_clothSolver.Build(m_cloth, columns, Config::clothCollisionExclusionHops);
+	ReserveContactBuffers();
+
+	//Whatever rested on the old cloth lost its support
+	WakeAll();
+}
 
-	for(size_t i = 0u; i < m_springs.size(); ++i)
+
+bool ParticleEngine::SaveSnapshot(const char* path) const
+{
+	using Snapshot::ArrayId;
+
+	Snapshot::Writer writer;
+	writer.header.randomSeed = m_randomSeed;
+	writer.header.clothColumns = m_clothColumns;
+	writer.header.clothIterations = m_clothSolver.GetIterations();
+	writer.header.clothCompliance = m_clothSolver.GetCompliance();
+	writer.header.sleepingParticles = m_sleepingParticles;
+	writer.header.sleepingBalls = m_sleepingBalls;
+	writer.header.accumulator = m_accumulator;
+	writer.header.capacityMode = static_cast<uint32_t>(m_particles.GetCapacityMode());
+
+	SetRingArray(writer, ArrayId::ParticlePositions, m_particles.Positions(), m_particles);
+	SetRingArray(writer, ArrayId::ParticleOldPositions, m_particles.OldPositions(), m_particles);
+	SetRingArray(writer, ArrayId::ParticleVelocities, m_particles.Velocities(), m_particles);
+	SetRingArray(writer, ArrayId::ParticleAccelerations, m_particles.Accelerations(), m_particles);
+	SetRingArray(writer, ArrayId::ParticleFlags, m_particles.Flags(), m_particles);
+
+	const std::vector<Snapshot::BodyRecord> balls = ToRecords(m_balls);
+	const std::vector<Snapshot::BodyRecord> cloth = ToRecords(m_cloth);
+	const std::vector<ClothSolver::Constraint>& constraints = m_clothSolver.GetConstraints();
+	writer.SetArray(ArrayId::Balls, sizeof(Snapshot::BodyRecord), balls.data(), balls.size());
+	writer.SetArray(ArrayId::ClothNodes, sizeof(Snapshot::BodyRecord), cloth.data(), cloth.size());
+	writer.SetArray(ArrayId::ClothConstraints, sizeof(ClothSolver::Constraint), constraints.data(), constraints.size());
+
+	std::vector<Snapshot::BlizzardRecord> blizzards(m_blizzards.size());
+	std::vector<glm::vec2> spawnPoints;
+	for (size_t i = 0u; i < m_blizzards.size(); ++i)
+	{
+		const std::vector<glm::vec2>& points = m_blizzards[i].GetSpawnPoints();
+		blizzards[i].spawnTime = m_blizzards[i].GetSpawnTime();
+		blizzards[i].spawnPointCount = static_cast<uint32_t>(points.size());
+		spawnPoints.insert(spawnPoints.end(), points.begin(), points.end());
+	}
+	writer.SetArray(ArrayId::Blizzards, sizeof(Snapshot::BlizzardRecord), blizzards.data(), blizzards.size());
+	writer.SetArray(ArrayId::BlizzardSpawnPoints, sizeof(glm::vec2), spawnPoints.data(), spawnPoints.size());
+
+	std::vector<Snapshot::BallGeneratorRecord> generators(m_ballGenerators.size());
+	for (size_t i = 0u; i < m_ballGenerators.size(); ++i)
+	{
+		generators[i].spawnTime = m_ballGenerators[i].GetSpawnTime();
+		generators[i].reserved = 0u;
+		generators[i].randomCounter = m_ballGenerators[i].GetRandomCounter();
+	}
+	writer.SetArray(ArrayId::BallGenerators, sizeof(Snapshot::BallGeneratorRecord), generators.data(), generators.size());
+
+	const std::vector<ContactSolver::CachedContact>& contacts = m_contactSolver.GetCache();
+	writer.SetArray(ArrayId::BallContacts, sizeof(ContactSolver::CachedContact), contacts.data(), contacts.size());
+
+	return writer.Write(path);
+}
+
+bool ParticleEngine::LoadSnapshot(const char* path)
+{
+	using Snapshot::ArrayId;
+
+	Snapshot::Reader reader;
+	if (!reader.Open(path))
+	{
+		return false;
+	}
+
+	const Snapshot::Header& header = reader.GetHeader();
+	const glm::vec2* positions = reader.GetArray<glm::vec2>(ArrayId::ParticlePositions);
+	const glm::vec2* oldPositions = reader.GetArray<glm::vec2>(ArrayId::ParticleOldPositions);
+	const glm::vec2* velocities = reader.GetArray<glm::vec2>(ArrayId::ParticleVelocities);
+	const glm::vec2* accelerations = reader.GetArray<glm::vec2>(ArrayId::ParticleAccelerations);
+	const uint8_t* flags = reader.GetArray<uint8_t>(ArrayId::ParticleFlags);
+	const Snapshot::BodyRecord* balls = reader.GetArray<Snapshot::BodyRecord>(ArrayId::Balls);
+	const Snapshot::BodyRecord* cloth = reader.GetArray<Snapshot::BodyRecord>(ArrayId::ClothNodes);
+	const ClothSolver::Constraint* constraints = reader.GetArray<ClothSolver::Constraint>(ArrayId::ClothConstraints);
+	const Snapshot::BlizzardRecord* blizzards = reader.GetArray<Snapshot::BlizzardRecord>(ArrayId::Blizzards);
+	const glm::vec2* spawnPoints = reader.GetArray<glm::vec2>(ArrayId::BlizzardSpawnPoints);
+	const Snapshot::BallGeneratorRecord* generators = reader.GetArray<Snapshot::BallGeneratorRecord>(ArrayId::BallGenerators);
+	const ContactSolver::CachedContact* contacts = reader.GetArray<ContactSolver::CachedContact>(ArrayId::BallContacts);
+
+	const size_t particleCount = reader.GetCount(ArrayId::ParticlePositions);
+	const size_t ballCount = reader.GetCount(ArrayId::Balls);
+	const size_t clothCount = reader.GetCount(ArrayId::ClothNodes);
+	const size_t constraintCount = reader.GetCount(ArrayId::ClothConstraints);
+	const size_t contactCount = reader.GetCount(ArrayId::BallContacts);
+
+	//Everything is checked before the first change, a rejected snapshot leaves the engine as it was
+	bool valid = positions && oldPositions && velocities && accelerations && flags
+		&& balls && cloth && constraints && blizzards && spawnPoints && generators && contacts
+		&& reader.GetCount(ArrayId::ParticleOldPositions) == particleCount
+		&& reader.GetCount(ArrayId::ParticleVelocities) == particleCount
+		&& reader.GetCount(ArrayId::ParticleAccelerations) == particleCount
+		&& reader.GetCount(ArrayId::ParticleFlags) == particleCount
+		&& reader.GetCount(ArrayId::Blizzards) == m_blizzards.size()
+		&& reader.GetCount(ArrayId::BallGenerators) == m_ballGenerators.size()
+		&& header.clothColumns <= clothCount
+		&& header.capacityMode <= static_cast<uint32_t>(ParticleStore::CapacityMode::DropNewest);
+
+	size_t spawnPointCount = 0u;
+	for (size_t i = 0u; i < m_blizzards.size() && valid; ++i)
+	{
+		valid = blizzards[i].spawnPointCount == m_blizzards[i].GetSpawnPoints().size();
+		spawnPointCount += blizzards[i].spawnPointCount;
+	}
+	valid = valid && spawnPointCount == reader.GetCount(ArrayId::BlizzardSpawnPoints);
+
+	for (size_t i = 0u; i < constraintCount && valid; ++i)
+	{
+		valid = constraints[i].a < clothCount && constraints[i].b < clothCount;
+	}
+
+	for (size_t i = 0u; i < contactCount && valid; ++i)
+	{
+		const uint32_t b = contacts[i].b;
+		valid = contacts[i].a < ballCount && ((b & ContactSolver::solidBit) ? (b & ~ContactSolver::solidBit) < m_solids.size() : b < ballCount);
+	}
+
+	if (!valid)
+	{
+		return false;
+	}
+
+	//The scene's particle budget holds like the ball budget below, a larger snapshot is trimmed as its capacity mode would have
+	m_particles.SetCapacityMode(static_cast<ParticleStore::CapacityMode>(header.capacityMode));
+	const size_t particlesKept = m_particles.Assign(particleCount, positions, oldPositions, velocities, accelerations, flags);
+
+	//Like AddBall, a store too small for the snapshot keeps the newest balls
+	m_balls.clear();
+	m_sleepingBalls = 0u;
+	for (size_t i = ballCount > m_ballCapacity ? ballCount - m_ballCapacity : 0u; i < ballCount; ++i)
+	{
+		m_balls.push_back(FromRecord(balls[i]));
+		m_sleepingBalls += m_balls.back().sleeping ? 1u : 0u;
+	}
+
+	//Cached impulses only fit when every ball kept its index
+	m_contactSolver.Clear();
+	if (ballCount <= m_ballCapacity)
+	{
+		m_contactSolver.Restore(contacts, contactCount);
+	}
+
+	//Constraints are stored in color order, coloring them again reproduces the same batches
+	m_cloth.clear();
+	m_clothSolver.Clear();
+	m_clothColumns = static_cast<size_t>(header.clothColumns);
+	for (size_t i = 0u; i < clothCount; ++i)
+	{
+		m_cloth.push_back(FromRecord(cloth[i]));
+	}
+	ReserveContactBuffers();
+	for (size_t i = 0u; i < constraintCount; ++i)
+	{
+		m_clothSolver.AddConstraint(constraints[i].a, constraints[i].b, constraints[i].restLength);
+	}
+	SetClothStiffness(static_cast<size_t>(header.clothIterations), header.clothCompliance);
+	m_clothSolver.Build(m_cloth, m_clothColumns, Config::clothCollisionExclusionHops);
+
+	SeedRandom(header.randomSeed);
+	for (size_t i = 0u, point = 0u; i < m_blizzards.size(); point += blizzards[i].spawnPointCount, ++i)
+	{
+		m_blizzards[i].RestoreState(blizzards[i].spawnTime, spawnPoints + point);
+	}
+	for (size_t i = 0u; i < m_ballGenerators.size(); ++i)
+	{
+		m_ballGenerators[i].RestoreState(generators[i].spawnTime, generators[i].randomCounter);
+	}
+
+	m_sleepingParticles = static_cast<size_t>(header.sleepingParticles);
+	if (particlesKept < particleCount)
+	{
+		m_sleepingParticles = 0u;
+		for (size_t i = 0u; i < particlesKept; ++i)
+		{
+			m_sleepingParticles += (m_particles.Flags()[i] & ParticleFlags::Sleeping) ? 1u : 0u;
+		}
+	}
+	m_accumulator = header.accumulator;
+	m_interpolationAlpha = 1.0f;
+
+	return true;
+}
+
+void ParticleEngine::BuildStaticGeometry()
+{
+	m_solidGrid.Build(m_solids);
+	m_forceField.Build(m_fans, m_solids, Config::forceFieldCellSize);
+	m_staticGeometryDirty = false;
+
+	//The discrete tests push a body out of the nearest face, past the middle of a solid that is the far one
+	m_sweepDistanceSquared = std::numeric_limits<float>::max();
+	if (Config::enableContinuousCollision)
+	{
+		for (size_t j = 0u; j < m_solids.size(); ++j)
+		{
+			const float sweepDistance = Config::sweepFraction * std::min(m_solids[j].oobb.halfSize.x, m_solids[j].oobb.halfSize.y);
+			m_sweepDistanceSquared = std::min(m_sweepDistanceSquared, sweepDistance * sweepDistance);
+		}
+	}
+
+	for (size_t w = 0u; w < m_workerScratch.size(); ++w)
+	{
+		m_workerScratch[w].solidCandidates.resize(m_solids.size());
+	}
+}
+
+void ParticleEngine::BuildBroadphase()
+{
+	//Largest distance at which two bodies can interact, particles reach one unit past a ball
+	float maxRadius = 0.0f;
+	for (size_t i = 0u; i < m_balls.size(); ++i)
+	{
+		maxRadius = std::max(maxRadius, m_balls[i].radius);
+	}
+	for (size_t i = m_clothColumns; i < m_cloth.size(); ++i)
+	{
+		maxRadius = std::max(maxRadius, m_cloth[i].radius);
+	}
+
+	m_dynamicGrid.Begin(std::max(2.0f * maxRadius, maxRadius + 1.0f), m_balls.size() + m_cloth.size());
+
+	for (size_t i = 0u; i < m_balls.size(); ++i)
+	{
+		m_dynamicGrid.Insert(m_balls[i].position, static_cast<uint32_t>(i));
+	}
+	for (size_t i = m_clothColumns; i < m_cloth.size(); ++i)
 	{
-		m_springVertices[i * 2].position.x = m_springs[i].p1->position.x;
-		m_springVertices[i * 2].position.y = m_springs[i].p1->position.y;
-		m_springVertices[i*2].color = sf::Color::Blue;
-		m_springVertices[i*2+1].position.x = m_springs[i].p2->position.x;
-		m_springVertices[i*2+1].position.y = m_springs[i].p2->position.y;
-		m_springVertices[i * 2 + 1].color = sf::Color::Blue;
+		m_dynamicGrid.Insert(m_cloth[i].position, static_cast<uint32_t>(i) | clothBodyBit);
 	}
+
+	m_dynamicGrid.Build();
 }
 
+void ParticleEngine::UpdateParticles(float deltaTime)
+{
+	if (m_staticGeometryDirty)
+	{
+		BuildStaticGeometry();
+	}
+
+	m_broadphaseStats.Reset();
+	BuildBroadphase();
+	m_ballContact.assign(m_balls.size(), 0u);
+
+	//Particles in parallel, each worker collects into its own scratch.
+	//They are integrated and collided in one fused pass, nothing they touch depends on the balls and cloth moving first.
+	const ParticlePipeline::IntegrateStage integrate(m_particles, EnvironmentForces(), deltaTime);
+	m_jobs.ParallelFor(m_particles.Size(), Config::particleChunkSize, [&](size_t begin, size_t end, size_t worker)
+	{
+		WorkerScratch& scratch = m_workerScratch[worker];
+		auto collide = [&](size_t blockBegin, size_t blockEnd)
+		{
+			CheckParticleCollisions(blockBegin, blockEnd, scratch);
+		};
+
+		ParticlePipeline::Run(begin, end, integrate, collide);
+	});
+
+	for (size_t w = 0u; w < m_workerScratch.size(); ++w)
+	{
+		m_broadphaseStats.pairsTested += m_workerScratch[w].broadphaseStats.pairsTested;
+		m_broadphaseStats.pairsHit += m_workerScratch[w].broadphaseStats.pairsHit;
+		m_workerScratch[w].broadphaseStats.Reset();
+	}
+}
 
 void ParticleEngine::CheckCollisions()
 {
 	ForceGenerators::ParticleCollision collision;
 	Collisions::Contact contact;
 
-	for (size_t i = 0u; i < m_particles.size(); ++i)
+	//The few balls and cloth nodes stay on this thread and borrow the first workers candidate lists
+	std::vector<std::vector<uint32_t>>& solidCandidates = m_workerScratch[0].solidCandidates;
+
+	for (size_t i = 0u; i < m_balls.size(); ++i)
 	{
-		for (size_t j = 0u; j < m_solids.size(); ++j)
+		//Sleeping balls only check whether a fan wakes them, awake bodies report their contacts
+		if (m_balls[i].sleeping)
 		{
-			if (Collisions::PointBoxCollision(m_particles[i].position, m_solids[j].aabb))
+			m_balls[i].acceleration += m_forceField.Sample(m_balls[i].position);
+			if (m_balls[i].acceleration != glm::vec2(0.0f))
 			{
-				//Collision with AABB!
-				if(Collisions::PointBoxCollision(m_solids[j].oobb, m_particles[i].position, contact))
-				{
-					//OOBB Collision!
-					contact.index = i;
-					m_particleReflexions.push_back(contact);
-				}
+				WakeBall(m_balls[i]);
 			}
+			continue;
 		}
 
-		//Check Balls
-		for (size_t j = 0u; j < m_balls.size(); ++j)
+		//Solids overlapping the balls bounds, fast balls are swept instead
+		const glm::vec2 ballMotion = m_balls[i].position - m_balls[i].oldPosition;
+		uint32_t solid;
+		if (glm::dot(ballMotion, ballMotion) > m_sweepDistanceSquared && SweepAgainstSolids(m_balls[i].oldPosition, m_balls[i].position, m_balls[i].radius, contact, solid))
+		{
+			m_contactSolver.AddContact(static_cast<uint32_t>(i), solid | ContactSolver::solidBit, contact.contactNormal, contact.penetration);
+			m_ballContact[i] = 1u;
+		}
+		else
 		{
-			if(Collisions::PointSphereCollision(m_particles[i].position, m_balls[j].position, m_balls[j].radius + 1.0f))
+			const glm::vec2 ballExtent(m_balls[i].radius);
+			m_solidGrid.QueryBox(m_balls[i].position - ballExtent, m_balls[i].position + ballExtent, [&](uint32_t j)
 			{
-				m_particles[i].toBeDeleted = true;
-			}
+				if (Collisions::SphereBoxCollision(m_balls[i].position, m_balls[i].radius, m_solids[j].aabb))
+				{
+					solidCandidates[j].push_back(static_cast<uint32_t>(i));
+				}
+			});
 		}
 
-		//Check Cloth
-		for (size_t j = Config::clothColumns; j < m_cloth.size(); ++j)
+		//Other balls and cloth, every ball pair is only reported by its lower index unless that one is asleep
+		m_dynamicGrid.Query(m_balls[i].position, [&](uint32_t id)
 		{
-			if (Collisions::PointSphereCollision(m_particles[i].position, m_cloth[j].position, m_cloth[j].radius))
+			const bool isCloth = (id & clothBodyBit) != 0u;
+			if (!isCloth && id <= i && !m_balls[id].sleeping)
 			{
-				m_particles[i].toBeDeleted = true;
+				return;
 			}
-		}
 
-		for (size_t j = 0u; j < m_fans.size(); ++j)
+			++m_broadphaseStats.pairsTested;
+
+			Ball& other = isCloth ? m_cloth[id & ~clothBodyBit] : m_balls[id];
+			if (Collisions::SphereSphereCollision(m_balls[i].position, m_balls[i].radius, other.position, other.radius, contact))
+			{
+				++m_broadphaseStats.pairsHit;
+
+				//The cloth never sleeps, resting on it does not count
+				if (isCloth)
+				{
+					m_balls[i].restSteps = 0u;
+
+					collision.p1 = &m_balls[i];
+					collision.p2 = &other;
+					collision.contact = contact;
+					m_particleCollisions.push_back(collision);
+				}
+				else
+				{
+					if (other.sleeping)
+					{
+						WakeBall(other);
+					}
+					m_ballContactPairs.push_back(std::make_pair(static_cast<uint32_t>(i), id));
+					m_ballContact[i] = 1u;
+					m_ballContact[id] = 1u;
+					m_contactSolver.AddContact(static_cast<uint32_t>(i), id, contact.contactNormal, contact.penetration);
+				}
+			}
+		});
+
+		//Fans
+		m_balls[i].acceleration += m_forceField.Sample(m_balls[i].position);
+	}
+
+	for (size_t j = 0u; j < m_solids.size(); ++j)
+	{
+		if (!solidCandidates[j].empty())
 		{
-			m_fans[j].InfluenceParticle(m_particles[i]);
+			Collisions::SpheresBoxCollision(m_solids[j].oobb, &m_balls[0], &solidCandidates[j][0], solidCandidates[j].size(), m_ballReflexions);
+			solidCandidates[j].clear();
+
+			for (size_t k = 0u; k < m_ballReflexions.size(); ++k)
+			{
+				m_contactSolver.AddContact(static_cast<uint32_t>(m_ballReflexions[k].index), static_cast<uint32_t>(j) | ContactSolver::solidBit, m_ballReflexions[k].contactNormal, m_ballReflexions[k].penetration);
+				m_ballContact[m_ballReflexions[k].index] = 1u;
+			}
+			m_ballReflexions.clear();
 		}
 	}
-	
 
-	for (size_t i = 0u; i < m_balls.size(); ++i)
+	for (size_t i = m_clothColumns; i < m_cloth.size(); ++i)
 	{
-		//Solids
-		for (size_t j = 0u; j < m_solids.size(); ++j)
+
+		//Solids overlapping the nodes bounds, fast nodes are swept instead
+		const glm::vec2 nodeMotion = m_cloth[i].position - m_cloth[i].oldPosition;
+		uint32_t solid;
+		if (glm::dot(nodeMotion, nodeMotion) > m_sweepDistanceSquared && SweepAgainstSolids(m_cloth[i].oldPosition, m_cloth[i].position, m_cloth[i].radius, contact, solid))
+		{
+			contact.index = i;
+			m_clothReflexions.push_back(contact);
+		}
+		else
 		{
-			if (Collisions::SphereBoxCollision(m_balls[i].position, m_balls[i].radius, m_solids[j].aabb))
+			const glm::vec2 nodeExtent(m_cloth[i].radius);
+			m_solidGrid.QueryBox(m_cloth[i].position - nodeExtent, m_cloth[i].position + nodeExtent, [&](uint32_t j)
 			{
-				if(Collisions::SphereBoxCollision(m_balls[i].position, m_balls[i].radius, m_solids[j].oobb, contact))
+				if (Collisions::SphereBoxCollision(m_cloth[i].position, m_cloth[i].radius, m_solids[j].aabb))
 				{
-					contact.index = i;
-					m_ballReflexions.push_back(contact);
+					solidCandidates[j].push_back(static_cast<uint32_t>(i));
 				}
-			}
+			});
 		}
-
-		//Collision Between balls O(N * log(N))
-		for (size_t j = i+1; j < m_balls.size(); ++j)
+		
+		//Cloth to cloth, awake balls already reported their cloth contacts and sleeping ones are woken for the next step.
+		//Nodes close in the constraint graph are left to the solver.
+		m_dynamicGrid.Query(m_cloth[i].position, [&](uint32_t id)
 		{
-			if (Collisions::SphereSphereCollision(m_balls[i].position, m_balls[i].radius, m_balls[j].position, m_balls[j].radius, contact))
+			if (!(id & clothBodyBit))
 			{
-				collision.p1 = &m_balls[i];
-				collision.p2 = &m_balls[j];
-				collision.contact = contact;
-				m_particleCollisions.push_back(collision);
+				if (m_balls[id].sleeping && Collisions::PointSphereCollision(m_cloth[i].position, m_balls[id].position, m_balls[id].radius + m_cloth[i].radius))
+				{
+					WakeBall(m_balls[id]);
+				}
+				return;
 			}
-		}
 
-		//Check Cloth
-		for (size_t j = Config::clothColumns; j < m_cloth.size(); ++j)
-		{
-			if (Collisions::SphereSphereCollision(m_balls[i].position, m_balls[i].radius, m_cloth[j].position, m_cloth[j].radius, contact))
+			if ((id & ~clothBodyBit) <= i || m_clothSolver.IsExcluded(static_cast<uint32_t>(i), id & ~clothBodyBit))
 			{
+				return;
+			}
+
+			++m_broadphaseStats.pairsTested;
 
-				collision.p1 = &m_balls[i];
-				collision.p2 = &m_cloth[j];
+			Ball& other = m_cloth[id & ~clothBodyBit];
+			if (Collisions::SphereSphereCollision(m_cloth[i].position, m_cloth[i].radius, other.position, other.radius, contact))
+			{
+				++m_broadphaseStats.pairsHit;
+				collision.p1 = &m_cloth[i];
+				collision.p2 = &other;
 				collision.contact = contact;
 				m_particleCollisions.push_back(collision);
 			}
-		}
+		});
 
-		//Fans
-		for (size_t j = 0u; j < m_fans.size(); ++j)
+		m_cloth[i].acceleration += m_forceField.Sample(m_cloth[i].position);
+	}
+
+	for (size_t j = 0u; j < m_solids.size(); ++j)
+	{
+		if (!solidCandidates[j].empty())
 		{
-			m_fans[j].InfluenceParticle(m_balls[i]);
+			Collisions::SpheresBoxCollision(m_solids[j].oobb, &m_cloth[0], &solidCandidates[j][0], solidCandidates[j].size(), m_clothReflexions);
+			solidCandidates[j].clear();
 		}
 	}
+}
 
-	for (size_t i = Config::clothColumns; i < m_cloth.size(); ++i)
+void ParticleEngine::CheckParticleCollisions(size_t begin, size_t end, WorkerScratch& scratch)
+{
+	glm::vec2* particlePositions = m_particles.Positions();
+	const glm::vec2* particleOldPositions = m_particles.OldPositions();
+	glm::vec2* particleAccelerations = m_particles.Accelerations();
+	uint8_t* particleFlags = m_particles.Flags();
+	Collisions::Contact contact;
+	uint32_t solid;
+
+	for (size_t i = begin; i < end; ++i)
 	{
+		//Particles only rest on solids, a sleeping one skips them and can only be hit by a body or woken by a fan
+		const bool sleeping = (particleFlags[i] & ParticleFlags::Sleeping) != 0u;
 
-		//Solids
-		for (size_t j = 0u; j < m_solids.size(); ++j)
+		//Solids sharing the particles cell, the OOBB test runs batched per solid below.
+		//A particle fast enough to pass through a solid is swept from its old position instead.
+		const glm::vec2 motion = particlePositions[i] - particleOldPositions[i];
+		if (!sleeping && glm::dot(motion, motion) > m_sweepDistanceSquared && SweepAgainstSolids(particleOldPositions[i], particlePositions[i], 0.0f, contact, solid))
+		{
+			contact.index = i;
+			scratch.particleReflexions.push_back(contact);
+		}
+		else if (!sleeping)
 		{
-			if (Collisions::SphereBoxCollision(m_cloth[i].position, m_cloth[i].radius, m_solids[j].aabb))
+			m_solidGrid.QueryPoint(particlePositions[i], [&](uint32_t j)
 			{
-				if (Collisions::SphereBoxCollision(m_cloth[i].position, m_cloth[i].radius, m_solids[j].oobb, contact))
+				if (Collisions::PointBoxCollision(particlePositions[i], m_solids[j].aabb))
 				{
-					contact.index = i;
-					m_clothReflexions.push_back(contact);
+					scratch.solidCandidates[j].push_back(static_cast<uint32_t>(i));
 				}
-			}
+			});
 		}
-		
-		//Cloth to cloth
-		for (size_t j = i; j < m_cloth.size(); ++j)
+
+		//Balls and cloth
+		m_dynamicGrid.Query(particlePositions[i], [&](uint32_t id)
 		{
-			if (Collisions::SphereSphereCollision(m_cloth[i].position, m_cloth[i].radius, m_cloth[j].position, m_cloth[j].radius, contact))
-			{
-				collision.p1 = &m_cloth[i];
-				collision.p2 = &m_cloth[j];
-				collision.contact = contact;
-				m_particleCollisions.push_back(collision);
+			++scratch.broadphaseStats.pairsTested;
+
+			const Ball& body = (id & clothBodyBit) ? m_cloth[id & ~clothBodyBit] : m_balls[id];
+			const float reach = (id & clothBodyBit) ? body.radius : body.radius + 1.0f;
 
+			if (Collisions::PointSphereCollision(particlePositions[i], body.position, reach))
+			{
+				++scratch.broadphaseStats.pairsHit;
+				particleFlags[i] |= ParticleFlags::ToBeDeleted;
 			}
+		});
+
+		particleAccelerations[i] += m_forceField.Sample(particlePositions[i]);
+
+		if (sleeping && particleAccelerations[i] != glm::vec2(0.0f))
+		{
+			particleFlags[i] &= ~(ParticleFlags::Sleeping | ParticleFlags::RestMask);
 		}
+	}
 
-		for (size_t j = 0u; j < m_fans.size(); ++j)
+	for (size_t j = 0u; j < m_solids.size(); ++j)
+	{
+		if (!scratch.solidCandidates[j].empty())
 		{
-			m_fans[j].InfluenceParticle(m_cloth[i]);
+			Collisions::PointsBoxCollision(m_solids[j].oobb, particlePositions, &scratch.solidCandidates[j][0], scratch.solidCandidates[j].size(), scratch.particleReflexions);
+			scratch.solidCandidates[j].clear();
 		}
 	}
 }
 
-void ParticleEngine::ApplyForces()
+//Only the first solid entered counts, a body that starts inside a solid is left to the discrete tests
+bool ParticleEngine::SweepAgainstSolids(const glm::vec2& start, const glm::vec2& end, float radius, Collisions::Contact& contact, uint32_t& solid) const
 {
-	for (size_t i = 0u; i < m_particles.size(); ++i)
+	float earliest = 2.0f;
+	Collisions::Contact candidate;
+	float timeOfImpact;
+
+	const glm::vec2 extent(radius);
+	m_solidGrid.QueryBox(glm::min(start, end) - extent, glm::max(start, end) + extent, [&](uint32_t j)
 	{
-		ForceGenerators::ApplyGravity(m_particles[i]);
-		ForceGenerators::ApplyAirDrag(m_particles[i]);
-	}
+		if (Collisions::SweptSphereBoxCollision(m_solids[j].oobb, start, end, radius, candidate, timeOfImpact) && timeOfImpact < earliest)
+		{
+			earliest = timeOfImpact;
+			contact = candidate;
+			solid = j;
+		}
+	});
+
+	return earliest <= 1.0f;
+}
+
+//Balls and cloth only, the particles are integrated by the pipeline in UpdateParticles
+void ParticleEngine::Integrate(float deltaTime)
+{
+	const ParticleKernels::Forces forces = EnvironmentForces();
+
+	m_ballIntegrated.resize(m_balls.size());
 	for (size_t i = 0u; i < m_balls.size(); ++i)
 	{
-		ForceGenerators::ApplyGravity(m_balls[i]);
-		ForceGenerators::ApplyAirDrag(m_balls[i]);
+		m_ballIntegrated[i] = m_balls[i].sleeping ? 0u : 1u;
+		if (!m_balls[i].sleeping)
+		{
+			ParticleKernels::ForceAndIntegrate(m_balls[i], forces, deltaTime);
+		}
 	}
-	for (size_t i = Config::clothColumns; i < m_cloth.size(); ++i)
+	for (size_t i = m_clothColumns; i < m_cloth.size(); ++i)
 	{
-		ForceGenerators::ApplyGravity(m_cloth[i]);
-		ForceGenerators::ApplyAirDrag(m_cloth[i]);
+		ParticleKernels::ForceAndIntegrate(m_cloth[i], forces, deltaTime);
 	}
-	for(size_t i = 0u; i < m_springs.size(); ++i)
+}
+
+void ParticleEngine::DeleteParticles()
+{
+	m_particles.Compact(Config::parallelParticleCompaction ? &m_jobs : nullptr);
+}
+
+void ParticleEngine::ResolveCollisions()
+{
+	//Each worker buffer only references particles of its own chunks, so the buffers resolve independently
+	m_jobs.ParallelFor(m_workerScratch.size(), 1u, [&](size_t begin, size_t end, size_t)
+	{
+		for (size_t w = begin; w < end; ++w)
+		{
+			std::vector<Collisions::Contact>& reflexions = m_workerScratch[w].particleReflexions;
+			uint8_t* flags = m_particles.Flags();
+
+			for (size_t i = 0u; i < reflexions.size(); ++i)
+			{
+				ForceGenerators::ApplyReflexion(m_particles, reflexions[i]);
+				flags[reflexions[i].index] |= ParticleFlags::Contact;
+			}
+			reflexions.clear();
+		}
+	});
+	
+	m_contactSolver.Solve(m_balls, m_ballIntegrated);
+
+	for (size_t i = 0u; i < m_clothReflexions.size(); ++i)
 	{
-		ForceGenerators::ApplySpringForces(*(m_springs[i].p1), *(m_springs[i].p2), m_springs[i].restLength, m_springs[i].stiffness);
+	ForceGenerators::ApplyReflexion(m_cloth[m_clothReflexions[i].index], m_clothReflexions[i]);
+	}	
+
+	for (size_t i = 0u; i < m_particleCollisions.size(); ++i)
+	{
+		ForceGenerators::ResolveCollision(*m_particleCollisions[i].p1, *m_particleCollisions[i].p2, m_particleCollisions[i].contact);
 	}
+	m_clothReflexions.clear();
+	m_particleCollisions.clear();
 }
 
-void ParticleEngine::Integrate(float deltaTime)
+void ParticleEngine::UpdateSleep(float deltaTime)
 {
-	for (size_t i = 0u; i < m_particles.size(); ++i)
+	m_sleepingParticles = 0u;
+	m_sleepingBalls = 0u;
+
+	if (!Config::enableSleeping)
 	{
-		m_particles[i].Integrate(deltaTime);
+		m_ballContactPairs.clear();
+		return;
 	}
-	for (size_t i = 0u; i < m_balls.size(); ++i)
+
+	const float maxRestMotion = Config::sleepSpeed * deltaTime;
+	const float maxRestMotionSquared = maxRestMotion * maxRestMotion;
+
+	m_jobs.ParallelFor(m_particles.Size(), Config::particleChunkSize, [&](size_t begin, size_t end, size_t worker)
 	{
-		m_balls[i].Integrate(deltaTime);
-	}
-	for (size_t i = Config::clothColumns; i < m_cloth.size(); ++i)
+		UpdateParticleSleep(begin, end, maxRestMotionSquared, m_workerScratch[worker]);
+	});
+
+	for (size_t w = 0u; w < m_workerScratch.size(); ++w)
 	{
-		m_cloth[i].Integrate(deltaTime);
+		m_sleepingParticles += m_workerScratch[w].sleepingParticles;
+		m_workerScratch[w].sleepingParticles = 0u;
 	}
+
+	UpdateBallSleep(maxRestMotionSquared);
 }
 
-void ParticleEngine::DeleteParticles()
+void ParticleEngine::UpdateParticleSleep(size_t begin, size_t end, float maxRestMotionSquared, WorkerScratch& scratch)
 {
-	std::vector<Particle>::iterator it = m_particles.begin();
-	std::vector<sf::Vertex>::iterator vit = m_particleVertices.begin();
+	glm::vec2* position = m_particles.Positions();
+	glm::vec2* oldPosition = m_particles.OldPositions();
+	glm::vec2* velocity = m_particles.Velocities();
+	glm::vec2* acceleration = m_particles.Accelerations();
+	uint8_t* flags = m_particles.Flags();
 
-	while(it != m_particles.end())
+	const size_t sleepSteps = std::min<size_t>(Config::sleepSteps, ParticleFlags::RestLimit);
+
+	for (size_t i = begin; i < end; ++i)
 	{
-		if(it->toBeDeleted)
+		uint8_t flag = flags[i];
+		if (flag & ParticleFlags::Sleeping)
 		{
-			it = m_particles.erase(it);
-			vit = m_particleVertices.erase(vit);
-		} else
+			++scratch.sleepingParticles;
+			continue;
+		}
+
+		//A particle resting on a solid bounces on it every few steps instead of touching it every step.
+		//Slow steps are counted and the particle falls asleep on its next contact once the count is reached,
+		//a free flying particle cannot stay slow that long under gravity.
+		const glm::vec2 motion = position[i] - oldPosition[i];
+		size_t restSteps = 0u;
+		if (glm::dot(motion, motion) < maxRestMotionSquared)
 		{
-			++it;
-			++vit;
+			restSteps = std::min<size_t>(((flag & ParticleFlags::RestMask) >> ParticleFlags::RestShift) + 1u, ParticleFlags::RestLimit);
 		}
-	}	
+
+		const bool touching = (flag & ParticleFlags::Contact) != 0u;
+		flag &= ~(ParticleFlags::Contact | ParticleFlags::RestMask);
+		flag |= static_cast<uint8_t>(restSteps << ParticleFlags::RestShift);
+
+		if (touching && restSteps >= sleepSteps)
+		{
+			flag |= ParticleFlags::Sleeping;
+			oldPosition[i] = position[i];
+			velocity[i] = glm::vec2(0.0f);
+			acceleration[i] = glm::vec2(0.0f);
+			++scratch.sleepingParticles;
+		}
+
+		flags[i] = flag;
+	}
 }
 
-void ParticleEngine::ResolveCollisions()
+//Balls in contact form islands, an island only sleeps once every member has been resting long enough
+//and wakes as a whole as soon as one member moves
+void ParticleEngine::UpdateBallSleep(float maxRestMotionSquared)
 {
+	m_islandParent.resize(m_balls.size());
+	m_islandRestSteps.assign(m_balls.size(), Config::sleepSteps);
 
-	for (size_t i = 0u; i < m_particleReflexions.size(); ++i)
+	for (size_t i = 0u; i < m_balls.size(); ++i)
 	{
-		ForceGenerators::ApplyReflexion(m_particles[m_particleReflexions[i].index], m_particleReflexions[i]);
+		m_islandParent[i] = static_cast<uint32_t>(i);
+
+		Ball& ball = m_balls[i];
+		if (ball.sleeping)
+		{
+			continue;
+		}
+
+		//Same rule as for particles, the count only has to be reached on a step with a contact
+		const glm::vec2 motion = ball.position - ball.oldPosition;
+		ball.restSteps = glm::dot(motion, motion) < maxRestMotionSquared ? ball.restSteps + 1u : 0u;
+		if (m_ballContact[i] == 0u && ball.restSteps >= Config::sleepSteps)
+		{
+			ball.restSteps = Config::sleepSteps - 1u;
+		}
 	}
-	
-	for (size_t i = 0u; i < m_ballReflexions.size(); ++i)
+
+	for (size_t i = 0u; i < m_ballContactPairs.size(); ++i)
 	{
-		ForceGenerators::ApplyReflexion(m_balls[m_ballReflexions[i].index], m_ballReflexions[i]);
+		const uint32_t a = FindIsland(m_ballContactPairs[i].first);
+		const uint32_t b = FindIsland(m_ballContactPairs[i].second);
+		if (a != b)
+		{
+			m_islandParent[std::max(a, b)] = std::min(a, b);
+		}
 	}
+	m_ballContactPairs.clear();
 
-	for (size_t i = 0u; i < m_clothReflexions.size(); ++i)
+	for (size_t i = 0u; i < m_balls.size(); ++i)
 	{
-	ForceGenerators::ApplyReflexion(m_cloth[m_clothReflexions[i].index], m_clothReflexions[i]);
-	}	
+		const uint32_t island = FindIsland(static_cast<uint32_t>(i));
+		m_islandRestSteps[island] = std::min(m_islandRestSteps[island], m_balls[i].restSteps);
+	}
 
-	for (size_t i = 0u; i < m_particleCollisions.size(); ++i)
+	for (size_t i = 0u; i < m_balls.size(); ++i)
 	{
-		ForceGenerators::ResolveCollision(*m_particleCollisions[i].p1, *m_particleCollisions[i].p2, m_particleCollisions[i].contact);
+		Ball& ball = m_balls[i];
+		const bool islandResting = m_islandRestSteps[FindIsland(static_cast<uint32_t>(i))] >= Config::sleepSteps;
+
+		if (islandResting && !ball.sleeping)
+		{
+			ball.sleeping = true;
+			ball.oldPosition = ball.position;
+			ball.velocity = glm::vec2(0.0f);
+			ball.acceleration = glm::vec2(0.0f);
+		}
+		else if (!islandResting)
+		{
+			ball.sleeping = false;
+		}
+
+		m_sleepingBalls += ball.sleeping ? 1u : 0u;
+	}
+}
+
+uint32_t ParticleEngine::FindIsland(uint32_t ball)
+{
+	//Path halving keeps the trees flat
+	while (m_islandParent[ball] != ball)
+	{
+		m_islandParent[ball] = m_islandParent[m_islandParent[ball]];
+		ball = m_islandParent[ball];
+	}
+	return ball;
+}
+
+void ParticleEngine::WakeBall(Ball& ball)
+{
+	ball.sleeping = false;
+	ball.restSteps = 0u;
+}
+
+void ParticleEngine::WakeAll()
+{
+	uint8_t* flags = m_particles.Flags();
+	for (size_t i = 0u; i < m_particles.Size(); ++i)
+	{
+		flags[i] &= ~(ParticleFlags::Sleeping | ParticleFlags::RestMask);
+	}
+
+	for (size_t i = 0u; i < m_balls.size(); ++i)
+	{
+		WakeBall(m_balls[i]);
 	}
-	m_particleReflexions.clear();
-	m_ballReflexions.clear();
-	m_clothReflexions.clear();
-	m_particleCollisions.clear();
 }
@@ -1,35 +1,142 @@
 ﻿#pragma once
 #include "Particle.h"
+#include "ParticleStore.h"
 #include <vector>
-#include "SFML/Graphics.hpp"
+#include <utility>
 #include "Solid.h"
 #include "Blizzard.h"
 #include "Ball.h"
 #include "Fan.h"
 #include "BallGenerator.h"
 #include "ForceGenerators.hpp"
+#include "SpatialGrid.h"
+#include "SolidGrid.h"
+#include "JobSystem.h"
+#include "ClothSolver.h"
+#include "ContactSolver.h"
+#include "Scene.h"
+#include "ForceField.h"
 
+//Headless simulation core, nothing in here depends on a window or a graphics library.
+//Frontends read the scene through the const getters, see ParticleRenderer for the SFML one.
 class ParticleEngine
 {
 public:
+	//Wall time of every phase of the last Update in nanoseconds
+	struct PhaseTimings
+	{
+		PhaseTimings() : emitters(0.0), integrateBodies(0.0), solveCloth(0.0), particlePipeline(0.0), checkCollisions(0.0), resolveCollisions(0.0), deleteParticles(0.0), updateSleep(0.0) {}
 
+		double Total() const { return emitters + integrateBodies + solveCloth + particlePipeline + checkCollisions + resolveCollisions + deleteParticles + updateSleep; }
+
+		double emitters;
+		double integrateBodies;		//Balls and cloth only
+		double solveCloth;
+		double particlePipeline;	//Particles integrated and collided in one fused pass, plus the broadphase it reads
+		double checkCollisions;		//Balls and cloth only
+		double resolveCollisions;
+		double deleteParticles;
+		double updateSleep;
+	};
+
+	//Default scene with the capacities from Config
 	ParticleEngine();
+	//Pools sized from the scene budgets, then the scene is loaded
+	explicit ParticleEngine(const SceneDescription& scene);
+	//Empty scene, filled through the Add functions below
+	ParticleEngine(size_t particleCapacity, size_t ballCapacity);
 	~ParticleEngine();
 
 	void Update(float deltaTime);
-	void Render(sf::RenderWindow& window);
-	void AddParticle(const Particle& particle);
+	//Runs as many fixed steps as the accumulated frame time covers, at most maxSubsteps.
+	//Time beyond that is dropped so a slow frame cannot snowball into ever longer ones.
+	//Returns the number of steps taken, GetInterpolationAlpha tells how far the remainder reaches into the next step
+	size_t Advance(float frameTime, float fixedStep, size_t maxSubsteps);
+	void AddParticle(const glm::vec2& position, const glm::vec2& velocity);
+	//Bulk emission straight into the store, see ParticleStore::AddParticles
+	template<typename Emit>
+	size_t AddParticles(size_t count, Emit emit)
+	{
+		return m_particles.AddParticles(count, emit);
+	}
 	void AddBall(const Ball& ball);
-	void GetInput(const sf::Event::MouseButtonEvent& e);
+	void SpawnBall(const glm::vec2& position);
+
+	//Scene setup. LoadScene adds the bodies of a scene, its budgets only apply when constructing from it.
+	void LoadScene(const SceneDescription& scene);
+	void LoadDefaultScene();
+	void AddSolid(const Solid& solid);
+	void AddBlizzard(const Blizzard& blizzard);
+	void AddBallGenerator(const BallGenerator& generator);
+	void AddFan(const Fan& fan);
+	//Replaces the cloth, its top row is pinned
+	void SetCloth(size_t columns, size_t rows, float nodeRadius, const glm::vec2& startPosition, float spacing);
+	//Solver iterations per step and compliance (inverse stiffness) of the cloth constraints
+	void SetClothStiffness(size_t iterations, float compliance);
+	//Reseeds every emitter, the same seed always replays the same scene
+	void SeedRandom(uint64_t seed);
+
+	//Writes particles, balls, cloth, emitter timers and random state, see Snapshot.h.
+	//The scene itself, solids, fans and where the emitters sit, is not part of it.
+	bool SaveSnapshot(const char* path) const;
+	//Adopts a snapshot into an engine holding the same scene. Fails without changing anything
+	//if the file is invalid or its emitters do not match this engine's.
+	bool LoadSnapshot(const char* path);
+
+	const ParticleStore& GetParticles() const { return m_particles; }
+	const std::vector<Ball>& GetBalls() const { return m_balls; }
+	const std::vector<Ball>& GetCloth() const { return m_cloth; }
+	size_t GetClothColumns() const { return m_clothColumns; }
+	const std::vector<ClothSolver::Constraint>& GetClothConstraints() const { return m_clothSolver.GetConstraints(); }
+	const std::vector<Solid>& GetSolids() const { return m_solids; }
+	const std::vector<Fan>& GetFans() const { return m_fans; }
+	const std::vector<Blizzard>& GetBlizzards() const { return m_blizzards; }
+	const std::vector<BallGenerator>& GetBallGenerators() const { return m_ballGenerators; }
+	const BroadphaseStats& GetBroadphaseStats() const { return m_broadphaseStats; }
+	const PhaseTimings& GetPhaseTimings() const { return m_phaseTimings; }
+	//Blend factor between oldPosition and position for rendering, 1 outside of Advance
+	float GetInterpolationAlpha() const { return m_interpolationAlpha; }
+	//Frame time Advance had to drop since construction
+	double GetDroppedTime() const { return m_droppedTime; }
+	size_t GetWorkerCount() const { return m_jobs.GetWorkerCount(); }
+	size_t GetSleepingParticleCount() const { return m_sleepingParticles; }
+	size_t GetSleepingBallCount() const { return m_sleepingBalls; }
+	//Changes whenever solids, fans or ball generators are added, frontends cache their static geometry against it
+	uint64_t GetStaticRevision() const { return m_staticRevision; }
 
 private:
-	void AddSpringContraint(size_t p1Index, size_t p2Index);
-	void GenerateCloth(const float ballRadius, const glm::vec2& startPosition, const float spacing);
+	//Marks cloth nodes in the dynamic grid, balls use their plain index
+	const static uint32_t clothBodyBit = 0x80000000u;
+
+	//Per worker output of the parallel collision pass. Every particle chunk is handled by exactly one worker,
+	//so the contacts in one buffer never touch a particle referenced by another buffer.
+	struct WorkerScratch
+	{
+		WorkerScratch() : sleepingParticles(0u) {}
+
+		std::vector<std::vector<uint32_t>> solidCandidates;
+		std::vector<Collisions::Contact> particleReflexions;
+		BroadphaseStats broadphaseStats;
+		size_t sleepingParticles;
+	};
+
+	void AddClothConstraint(size_t p1Index, size_t p2Index);
+	void ReserveContactBuffers();
+	void BuildStaticGeometry();
+	void BuildBroadphase();
+	void UpdateParticles(float deltaTime);
 	void CheckCollisions();
+	void CheckParticleCollisions(size_t begin, size_t end, WorkerScratch& scratch);
+	bool SweepAgainstSolids(const glm::vec2& start, const glm::vec2& end, float radius, Collisions::Contact& contact, uint32_t& solid) const;
 	void ResolveCollisions();
-	void ApplyForces();
 	void Integrate(float deltaTime);
 	void DeleteParticles();
+	void UpdateSleep(float deltaTime);
+	void UpdateParticleSleep(size_t begin, size_t end, float maxRestMotionSquared, WorkerScratch& scratch);
+	void UpdateBallSleep(float maxRestMotionSquared);
+	uint32_t FindIsland(uint32_t ball);
+	void WakeBall(Ball& ball);
+	void WakeAll();
 
 	//Spawners
 	std::vector<Blizzard> m_blizzards;
@@ -37,22 +144,46 @@ private:
 
 	//Dynamics
 	std::vector<Solid> m_solids;
-	std::vector<Particle> m_particles;
+	SolidGrid m_solidGrid;
+	ParticleStore m_particles;
 	std::vector<Ball> m_balls;
 	std::vector<Ball> m_cloth;
+	ClothSolver m_clothSolver;
+	size_t m_ballCapacity;
+	size_t m_clothColumns;
+	bool m_staticGeometryDirty;
+	float m_sweepDistanceSquared; //Displacement per step above which a body can pass through the thinnest solid
+	uint64_t m_staticRevision;
+	uint64_t m_randomSeed;
 
-	//Forces
+	//Forces, the fans are sampled through the force field
 	std::vector<Fan> m_fans;
-	std::vector<ForceGenerators::SpringContraint> m_springs;
+	ForceField m_forceField;
 
-	//Collisions
-	std::vector<Collisions::Contact> m_particleReflexions;
+	//Collisions. Ball contacts with solids and other balls go through the contact solver, m_ballReflexions only stages them.
 	std::vector<Collisions::Contact> m_ballReflexions;
+	ContactSolver m_contactSolver;
 	std::vector<Collisions::Contact> m_clothReflexions;
 	std::vector<ForceGenerators::ParticleCollision> m_particleCollisions;
+	SpatialGrid m_dynamicGrid;
+	BroadphaseStats m_broadphaseStats;
+	PhaseTimings m_phaseTimings;
+
+	//Sleeping. Balls touching a solid or another ball this step and the ball pairs in contact, the pairs join balls into islands
+	std::vector<uint8_t> m_ballContact;
+	std::vector<uint8_t> m_ballIntegrated; //Balls that were awake when this step integrated them
+	std::vector<std::pair<uint32_t, uint32_t>> m_ballContactPairs;
+	std::vector<uint32_t> m_islandParent;
+	std::vector<size_t> m_islandRestSteps;
+	size_t m_sleepingParticles;
+	size_t m_sleepingBalls;
+
+	//Fixed stepping
+	float m_accumulator;
+	float m_interpolationAlpha;
+	double m_droppedTime;
 
-	//Rendering Stuff
-	std::vector<sf::Vertex> m_particleVertices;
-	std::vector<sf::Vertex> m_springVertices;
-	sf::CircleShape renderCircle;
+	//Threading
+	JobSystem m_jobs;
+	std::vector<WorkerScratch> m_workerScratch;
 };
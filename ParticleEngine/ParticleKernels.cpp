@@ -0,0 +1,187 @@
+#include "ParticleKernels.h"
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+
+#if PARTICLE_ENGINE_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	void ForceAndIntegrateScalar(glm::vec2* position, glm::vec2* oldPosition, glm::vec2* velocity, glm::vec2* acceleration, size_t begin, size_t end, const ParticleKernels::Forces& forces, float deltaTime)
+	{
+		const float halfDeltaTimeSquared = 0.5f * deltaTime * deltaTime;
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			const glm::vec2 a = acceleration[i] + forces.gravity;
+			const glm::vec2 v = velocity[i] * forces.drag + a;
+
+			oldPosition[i] = position[i];
+			position[i] += v * deltaTime + a * halfDeltaTimeSquared;
+			velocity[i] = v;
+			acceleration[i] = glm::vec2(0.0f);
+		}
+	}
+
+#if PARTICLE_ENGINE_X86
+	//Two particles per register, unrolled twice to move four particles per iteration
+	size_t ForceAndIntegrateSSE2(float* position, float* oldPosition, float* velocity, float* acceleration, size_t count, const ParticleKernels::Forces& forces, float deltaTime)
+	{
+		const __m128 gravity = _mm_setr_ps(forces.gravity.x, forces.gravity.y, forces.gravity.x, forces.gravity.y);
+		const __m128 drag = _mm_set1_ps(forces.drag);
+		const __m128 dt = _mm_set1_ps(deltaTime);
+		const __m128 halfDtSquared = _mm_set1_ps(0.5f * deltaTime * deltaTime);
+		const __m128 zero = _mm_setzero_ps();
+
+		size_t i = 0u;
+		for (; i + 4u <= count; i += 4u)
+		{
+			for (size_t half = 0u; half < 2u; ++half)
+			{
+				const size_t f = i * 2u + half * 4u;
+
+				const __m128 a = _mm_add_ps(_mm_loadu_ps(acceleration + f), gravity);
+				const __m128 v = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(velocity + f), drag), a);
+				const __m128 p = _mm_loadu_ps(position + f);
+
+				_mm_storeu_ps(oldPosition + f, p);
+				_mm_storeu_ps(position + f, _mm_add_ps(p, _mm_add_ps(_mm_mul_ps(v, dt), _mm_mul_ps(a, halfDtSquared))));
+				_mm_storeu_ps(velocity + f, v);
+				_mm_storeu_ps(acceleration + f, zero);
+			}
+		}
+
+		return i;
+	}
+
+	//Four particles per register, unrolled twice to move eight particles per iteration
+	PARTICLE_ENGINE_TARGET_AVX2
+	size_t ForceAndIntegrateAVX2(float* position, float* oldPosition, float* velocity, float* acceleration, size_t count, const ParticleKernels::Forces& forces, float deltaTime)
+	{
+		const __m256 gravity = _mm256_setr_ps(forces.gravity.x, forces.gravity.y, forces.gravity.x, forces.gravity.y, forces.gravity.x, forces.gravity.y, forces.gravity.x, forces.gravity.y);
+		const __m256 drag = _mm256_set1_ps(forces.drag);
+		const __m256 dt = _mm256_set1_ps(deltaTime);
+		const __m256 halfDtSquared = _mm256_set1_ps(0.5f * deltaTime * deltaTime);
+		const __m256 zero = _mm256_setzero_ps();
+
+		size_t i = 0u;
+		for (; i + 8u <= count; i += 8u)
+		{
+			for (size_t half = 0u; half < 2u; ++half)
+			{
+				const size_t f = i * 2u + half * 8u;
+
+				const __m256 a = _mm256_add_ps(_mm256_loadu_ps(acceleration + f), gravity);
+				const __m256 v = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(velocity + f), drag), a);
+				const __m256 p = _mm256_loadu_ps(position + f);
+
+				_mm256_storeu_ps(oldPosition + f, p);
+				_mm256_storeu_ps(position + f, _mm256_add_ps(p, _mm256_add_ps(_mm256_mul_ps(v, dt), _mm256_mul_ps(a, halfDtSquared))));
+				_mm256_storeu_ps(velocity + f, v);
+				_mm256_storeu_ps(acceleration + f, zero);
+			}
+		}
+
+		return i;
+	}
+#endif
+
+	//Small deterministic generator so the verification input is identical on every run
+	float NextTestValue(uint32_t& state, float range)
+	{
+		state = state * 1664525u + 1013904223u;
+		return (static_cast<float>(state >> 8) / 16777216.0f * 2.0f - 1.0f) * range;
+	}
+}
+
+void ParticleKernels::ForceAndIntegrate(SimdSupport::InstructionSet set, glm::vec2* position, glm::vec2* oldPosition, glm::vec2* velocity, glm::vec2* acceleration, size_t count, const Forces& forces, float deltaTime)
+{
+	size_t done = 0u;
+
+#if PARTICLE_ENGINE_X86
+	float* p = reinterpret_cast<float*>(position);
+	float* o = reinterpret_cast<float*>(oldPosition);
+	float* v = reinterpret_cast<float*>(velocity);
+	float* a = reinterpret_cast<float*>(acceleration);
+
+	if (set == SimdSupport::InstructionSet::AVX2)
+	{
+		done = ForceAndIntegrateAVX2(p, o, v, a, count, forces, deltaTime);
+	}
+	else if (set == SimdSupport::InstructionSet::SSE2)
+	{
+		done = ForceAndIntegrateSSE2(p, o, v, a, count, forces, deltaTime);
+	}
+#endif
+
+	//Scalar fallback and the tail the vector loops left over
+	ForceAndIntegrateScalar(position, oldPosition, velocity, acceleration, done, count, forces, deltaTime);
+}
+
+void ParticleKernels::ForceAndIntegrate(ParticleStore& store, const Forces& forces, float deltaTime)
+{
+	ForceAndIntegrate(SimdSupport::GetActive(), store.Positions(), store.OldPositions(), store.Velocities(), store.Accelerations(), store.Size(), forces, deltaTime);
+}
+
+void ParticleKernels::ForceAndIntegrate(Particle& particle, const Forces& forces, float deltaTime)
+{
+	ForceAndIntegrateScalar(&particle.position, &particle.oldPosition, &particle.velocity, &particle.acceleration, 0u, 1u, forces, deltaTime);
+}
+
+bool ParticleKernels::Verify(float tolerance)
+{
+	//Odd count so every path also runs its scalar tail
+	const size_t count = 1031u;
+	const float deltaTime = 1.0f / 60.0f;
+
+	Forces forces;
+	forces.gravity = glm::vec2(0.0f, 9.81f);
+	forces.drag = 0.99f;
+
+	std::vector<glm::vec2> input[4];
+	uint32_t state = 12345u;
+	for (size_t a = 0u; a < 4u; ++a)
+	{
+		input[a].resize(count);
+		for (size_t i = 0u; i < count; ++i)
+		{
+			input[a][i].x = NextTestValue(state, 1000.0f);
+			input[a][i].y = NextTestValue(state, 1000.0f);
+		}
+	}
+
+	std::vector<glm::vec2> expected[4] = { input[0], input[1], input[2], input[3] };
+	ForceAndIntegrate(SimdSupport::InstructionSet::Scalar, &expected[0][0], &expected[1][0], &expected[2][0], &expected[3][0], count, forces, deltaTime);
+
+	const SimdSupport::InstructionSet sets[] = { SimdSupport::InstructionSet::SSE2, SimdSupport::InstructionSet::AVX2 };
+	for (size_t s = 0u; s < 2u; ++s)
+	{
+		if (sets[s] > SimdSupport::Detect())
+		{
+			continue;
+		}
+
+		std::vector<glm::vec2> actual[4] = { input[0], input[1], input[2], input[3] };
+		ForceAndIntegrate(sets[s], &actual[0][0], &actual[1][0], &actual[2][0], &actual[3][0], count, forces, deltaTime);
+
+		for (size_t a = 0u; a < 4u; ++a)
+		{
+			for (size_t i = 0u; i < count; ++i)
+			{
+				const glm::vec2 difference = actual[a][i] - expected[a][i];
+				const float scale = std::max(1.0f, std::max(std::fabs(expected[a][i].x), std::fabs(expected[a][i].y)));
+
+				if (std::fabs(difference.x) > tolerance * scale || std::fabs(difference.y) > tolerance * scale)
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
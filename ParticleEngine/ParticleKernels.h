@@ -0,0 +1,26 @@
+#pragma once
+#include <glm/glm.hpp>
+#include "Particle.h"
+#include "ParticleStore.h"
+#include "SimdSupport.h"
+
+//Fused per particle update: gravity, air drag and the integration step in one pass.
+//Every operation is per component, so the interleaved xy arrays are processed as plain float streams.
+namespace ParticleKernels
+{
+	struct Forces
+	{
+		glm::vec2 gravity;
+		float drag;
+	};
+
+	void ForceAndIntegrate(SimdSupport::InstructionSet set, glm::vec2* position, glm::vec2* oldPosition, glm::vec2* velocity, glm::vec2* acceleration, size_t count, const Forces& forces, float deltaTime);
+
+	//Dispatches to SimdSupport::GetActive()
+	void ForceAndIntegrate(ParticleStore& store, const Forces& forces, float deltaTime);
+	void ForceAndIntegrate(Particle& particle, const Forces& forces, float deltaTime);
+
+	//Runs every supported vector path against the scalar one on the same random input,
+	//true if all results agree within tolerance
+	bool Verify(float tolerance);
+}
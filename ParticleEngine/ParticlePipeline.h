@@ -0,0 +1,78 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include "Config.hpp"
+#include "ParticleStore.h"
+#include "ParticleKernels.h"
+#include "SimdSupport.h"
+
+//Compile time composed particle update. A pipeline is a list of stages, each callable as stage(begin, end).
+//Run walks its range in blocks small enough to stay in the L1 cache and hands every block to all stages in order
+//before moving on, so each particle is pulled from memory once per step instead of once per pass.
+//The stages are template arguments, their calls are resolved at compile time and inline into the one loop.
+namespace ParticlePipeline
+{
+	template<typename... Stages>
+	void Run(size_t begin, size_t end, Stages&... stages)
+	{
+		for (size_t block = begin; block < end; block += Config::particleBlockSize)
+		{
+			const size_t blockEnd = std::min(block + Config::particleBlockSize, end);
+
+			//Expands to one call per stage, left to right
+			const bool ran[] = { true, (stages(block, blockEnd), true)... };
+			(void)ran;
+		}
+	}
+
+	//Gravity, air drag and the integration step, runs of awake particles go through the vector kernel
+	class IntegrateStage
+	{
+	public:
+		IntegrateStage(ParticleStore& store, const ParticleKernels::Forces& forces, float deltaTime)
+			: m_position(store.Positions())
+			, m_oldPosition(store.OldPositions())
+			, m_velocity(store.Velocities())
+			, m_acceleration(store.Accelerations())
+			, m_flags(store.Flags())
+			, m_forces(forces)
+			, m_deltaTime(deltaTime)
+			, m_instructionSet(SimdSupport::GetActive())
+		{
+		}
+
+		void operator()(size_t begin, size_t end) const
+		{
+			size_t first = begin;
+			while (first < end)
+			{
+				while (first < end && (m_flags[first] & ParticleFlags::Sleeping))
+				{
+					++first;
+				}
+
+				size_t last = first;
+				while (last < end && !(m_flags[last] & ParticleFlags::Sleeping))
+				{
+					++last;
+				}
+
+				if (last > first)
+				{
+					ParticleKernels::ForceAndIntegrate(m_instructionSet, m_position + first, m_oldPosition + first, m_velocity + first, m_acceleration + first, last - first, m_forces, m_deltaTime);
+				}
+				first = last;
+			}
+		}
+
+	private:
+		glm::vec2* m_position;
+		glm::vec2* m_oldPosition;
+		glm::vec2* m_velocity;
+		glm::vec2* m_acceleration;
+		const uint8_t* m_flags;
+		ParticleKernels::Forces m_forces;
+		float m_deltaTime;
+		SimdSupport::InstructionSet m_instructionSet;
+	};
+}
@@ -0,0 +1,171 @@
+﻿#include "ParticleRenderer.h"
+#include "Config.hpp"
+#include "Profiler.h"
+#include <cmath>
+
+namespace
+{
+	sf::Vertex MakeVertex(const glm::vec2& position, const sf::Color& color)
+	{
+		return sf::Vertex(sf::Vector2f(position.x, position.y), color);
+	}
+
+	glm::vec2 Interpolate(const glm::vec2& oldPosition, const glm::vec2& position, float alpha)
+	{
+		return oldPosition + (position - oldPosition) * alpha;
+	}
+}
+
+ParticleRenderer::ParticleRenderer()
+	: m_staticRevision(0u)
+	, m_staticValid(false)
+	, m_drawCalls(0u)
+{
+	for (size_t i = 0u; i < circleSegments; ++i)
+	{
+		const float angle = 2.0f * Config::pi * static_cast<float>(i) / static_cast<float>(circleSegments);
+		m_unitCircle[i] = glm::vec2(std::cos(angle), std::sin(angle));
+	}
+}
+
+void ParticleRenderer::Render(const ParticleEngine& engine, sf::RenderWindow& window, float alpha)
+{
+	Profiler::ScopedTimer timer("Draw");
+
+	m_drawCalls = 0u;
+
+	if (!m_staticValid || m_staticRevision != engine.GetStaticRevision())
+	{
+		BuildStatic(engine);
+	}
+	Draw(m_staticVertices, sf::PrimitiveType::Triangles, window);
+
+	//Cloth, the pinned top row is not drawn, its constraints and the balls
+	m_lineVertices.clear();
+	AddCircles(engine.GetCloth(), engine.GetClothColumns(), alpha);
+
+	const std::vector<Ball>& cloth = engine.GetCloth();
+	const std::vector<ClothSolver::Constraint>& constraints = engine.GetClothConstraints();
+	for (size_t i = 0u; i < constraints.size(); ++i)
+	{
+		const Ball& a = cloth[constraints[i].a];
+		const Ball& b = cloth[constraints[i].b];
+		m_lineVertices.push_back(MakeVertex(Interpolate(a.oldPosition, a.position, alpha), sf::Color::Blue));
+		m_lineVertices.push_back(MakeVertex(Interpolate(b.oldPosition, b.position, alpha), sf::Color::Blue));
+	}
+
+	AddCircles(engine.GetBalls(), 0u, alpha);
+	Draw(m_lineVertices, sf::PrimitiveType::Lines, window);
+
+	//Blizzard spawn points and particles
+	m_pointVertices.clear();
+	const std::vector<Blizzard>& blizzards = engine.GetBlizzards();
+	for (size_t i = 0u; i < blizzards.size(); ++i)
+	{
+		const std::vector<glm::vec2>& spawnPoints = blizzards[i].GetSpawnPoints();
+		for (size_t j = 0u; j < spawnPoints.size(); ++j)
+		{
+			m_pointVertices.push_back(MakeVertex(spawnPoints[j], sf::Color::Red));
+		}
+	}
+
+	const ParticleStore& particles = engine.GetParticles();
+	const glm::vec2* particlePositions = particles.Positions();
+	const glm::vec2* particleOldPositions = particles.OldPositions();
+	const size_t firstParticle = m_pointVertices.size();
+	m_pointVertices.resize(firstParticle + particles.Size());
+	for (size_t i = 0u; i < particles.Size(); ++i)
+	{
+		m_pointVertices[firstParticle + i] = MakeVertex(Interpolate(particleOldPositions[i], particlePositions[i], alpha), sf::Color::White);
+	}
+
+	Draw(m_pointVertices, sf::PrimitiveType::Points, window);
+}
+
+void ParticleRenderer::BuildStatic(const ParticleEngine& engine)
+{
+	m_staticVertices.clear();
+
+	//Solids as two triangles each
+	const std::vector<Solid>& solids = engine.GetSolids();
+	for (size_t i = 0u; i < solids.size(); ++i)
+	{
+		const Collisions::BoundingVolumes::OOBB& oobb = solids[i].oobb;
+		const glm::vec2 corners[4] =
+		{
+			Collisions::LocalToWorld(oobb, glm::vec2(-oobb.halfSize.x, -oobb.halfSize.y)),
+			Collisions::LocalToWorld(oobb, glm::vec2(oobb.halfSize.x, -oobb.halfSize.y)),
+			Collisions::LocalToWorld(oobb, glm::vec2(oobb.halfSize.x, oobb.halfSize.y)),
+			Collisions::LocalToWorld(oobb, glm::vec2(-oobb.halfSize.x, oobb.halfSize.y))
+		};
+
+		const size_t order[6] = { 0u, 1u, 2u, 0u, 2u, 3u };
+		for (size_t j = 0u; j < 6u; ++j)
+		{
+			m_staticVertices.push_back(MakeVertex(corners[order[j]], sf::Color::Red));
+		}
+	}
+
+	//Fans and ball generators, the line they sit on plus an arrow for their direction and strength
+	const std::vector<Fan>& fans = engine.GetFans();
+	for (size_t i = 0u; i < fans.size(); ++i)
+	{
+		AddArrow(fans[i].GetStart(), fans[i].GetEnd(), fans[i].GetBlowDirection(), fans[i].GetStrength(), sf::Color::Green);
+	}
+
+	const std::vector<BallGenerator>& generators = engine.GetBallGenerators();
+	for (size_t i = 0u; i < generators.size(); ++i)
+	{
+		AddArrow(generators[i].GetStart(), generators[i].GetEnd(), generators[i].GetSpawnDirection(), generators[i].GetSpawnVelocity(), sf::Color::Cyan);
+	}
+
+	m_staticRevision = engine.GetStaticRevision();
+	m_staticValid = true;
+}
+
+void ParticleRenderer::AddCircles(const std::vector<Ball>& balls, size_t first, float alpha)
+{
+	for (size_t i = first; i < balls.size(); ++i)
+	{
+		const glm::vec2 position = Interpolate(balls[i].oldPosition, balls[i].position, alpha);
+		const float radius = balls[i].radius;
+
+		for (size_t j = 0u; j < circleSegments; ++j)
+		{
+			const size_t next = j + 1u == circleSegments ? 0u : j + 1u;
+			m_lineVertices.push_back(MakeVertex(position + m_unitCircle[j] * radius, sf::Color::Yellow));
+			m_lineVertices.push_back(MakeVertex(position + m_unitCircle[next] * radius, sf::Color::Yellow));
+		}
+	}
+}
+
+void ParticleRenderer::AddArrow(const glm::vec2& start, const glm::vec2& end, const glm::vec2& direction, float length, const sf::Color& color)
+{
+	const glm::vec2 center = (start + end) * 0.5f;
+
+	AddThickLine(start, end, color);
+	AddThickLine(center, center + direction * length, color);
+}
+
+//One pixel wide quad, so lines can share the triangle array with the solids
+void ParticleRenderer::AddThickLine(const glm::vec2& start, const glm::vec2& end, const sf::Color& color)
+{
+	const glm::vec2 direction = Collisions::saveNormalize(end - start);
+	const glm::vec2 offset(-direction.y * 0.5f, direction.x * 0.5f);
+
+	m_staticVertices.push_back(MakeVertex(start - offset, color));
+	m_staticVertices.push_back(MakeVertex(end - offset, color));
+	m_staticVertices.push_back(MakeVertex(end + offset, color));
+	m_staticVertices.push_back(MakeVertex(start - offset, color));
+	m_staticVertices.push_back(MakeVertex(end + offset, color));
+	m_staticVertices.push_back(MakeVertex(start + offset, color));
+}
+
+void ParticleRenderer::Draw(const std::vector<sf::Vertex>& vertices, sf::PrimitiveType type, sf::RenderWindow& window)
+{
+	if (!vertices.empty())
+	{
+		window.draw(&vertices[0], vertices.size(), type);
+		++m_drawCalls;
+	}
+}
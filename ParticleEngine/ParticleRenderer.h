@@ -0,0 +1,43 @@
+﻿#pragma once
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include "ParticleEngine.h"
+
+//SFML frontend of the simulation, reads the engine state and draws it into a window.
+//The engine itself never sees this class.
+//Everything is batched into three vertex arrays, one per primitive type, so the number of draw calls
+//does not grow with the number of bodies.
+class ParticleRenderer
+{
+public:
+	ParticleRenderer();
+
+	//alpha blends every body between its previous and current step, see ParticleEngine::Advance
+	void Render(const ParticleEngine& engine, sf::RenderWindow& window, float alpha = 1.0f);
+
+	//window.draw calls issued by the last Render
+	size_t GetDrawCalls() const { return m_drawCalls; }
+
+private:
+	const static size_t circleSegments = 15u;
+
+	void BuildStatic(const ParticleEngine& engine);
+	void AddCircles(const std::vector<Ball>& balls, size_t first, float alpha);
+	void AddArrow(const glm::vec2& start, const glm::vec2& end, const glm::vec2& direction, float length, const sf::Color& color);
+	void AddThickLine(const glm::vec2& start, const glm::vec2& end, const sf::Color& color);
+	void Draw(const std::vector<sf::Vertex>& vertices, sf::PrimitiveType type, sf::RenderWindow& window);
+
+	//Outline of a circle with radius 1, scaled and moved for every ball
+	glm::vec2 m_unitCircle[circleSegments];
+
+	//Solids, fans and ball generators as triangles, only rebuilt when the engines static revision changes
+	std::vector<sf::Vertex> m_staticVertices;
+	uint64_t m_staticRevision;
+	bool m_staticValid;
+
+	//Rebuilt every frame, the arrays keep their capacity
+	std::vector<sf::Vertex> m_lineVertices;
+	std::vector<sf::Vertex> m_pointVertices;
+
+	size_t m_drawCalls;
+};
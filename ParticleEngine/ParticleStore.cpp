@@ -0,0 +1,395 @@
+#include "ParticleStore.h"
+#include "JobSystem.h"
+#include <xmmintrin.h>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include <limits>
+#include <new>
+
+namespace
+{
+	//Padded by one alignment block so vectorized loops may read past the last element.
+	//nullptr if the padded size does not fit into size_t or the allocation fails.
+	template<typename T>
+	T* AlignedAllocate(size_t count)
+	{
+		if (count > (std::numeric_limits<size_t>::max() - ParticleStore::alignment) / sizeof(T))
+		{
+			return nullptr;
+		}
+
+		return static_cast<T*>(_mm_malloc(count * sizeof(T) + ParticleStore::alignment, ParticleStore::alignment));
+	}
+
+	template<typename T>
+	void AlignedFree(T*& pointer)
+	{
+		if (pointer != nullptr)
+		{
+			_mm_free(pointer);
+			pointer = nullptr;
+		}
+	}
+
+	//All five arrays or none, on failure the outputs are left alone and std::bad_alloc is thrown
+	void AllocateArrays(size_t capacity, glm::vec2*& position, glm::vec2*& oldPosition, glm::vec2*& velocity, glm::vec2*& acceleration, uint8_t*& flags)
+	{
+		glm::vec2* newPosition = AlignedAllocate<glm::vec2>(capacity);
+		glm::vec2* newOldPosition = AlignedAllocate<glm::vec2>(capacity);
+		glm::vec2* newVelocity = AlignedAllocate<glm::vec2>(capacity);
+		glm::vec2* newAcceleration = AlignedAllocate<glm::vec2>(capacity);
+		uint8_t* newFlags = AlignedAllocate<uint8_t>(capacity);
+
+		if (!newPosition || !newOldPosition || !newVelocity || !newAcceleration || !newFlags)
+		{
+			AlignedFree(newPosition);
+			AlignedFree(newOldPosition);
+			AlignedFree(newVelocity);
+			AlignedFree(newAcceleration);
+			AlignedFree(newFlags);
+			throw std::bad_alloc();
+		}
+
+		position = newPosition;
+		oldPosition = newOldPosition;
+		velocity = newVelocity;
+		acceleration = newAcceleration;
+		flags = newFlags;
+	}
+
+	//Maps a logical index (0 = oldest) to its slot in a ring buffer starting at head
+	inline size_t Physical(size_t logical, size_t head, size_t count)
+	{
+		size_t index = logical + head;
+		return index >= count ? index - count : index;
+	}
+}
+
+ParticleMaterial::ParticleMaterial()
+{
+	mass = 1.0f;
+	inverseMass = 1.0f / mass;
+	bounciness = 0.25f;
+	staticFriction = 0.9f;
+	kinematicFriction = 0.7f;
+}
+
+ParticleStore::ParticleStore()
+	: m_position(nullptr)
+	, m_oldPosition(nullptr)
+	, m_velocity(nullptr)
+	, m_acceleration(nullptr)
+	, m_flags(nullptr)
+	, m_scratchPosition(nullptr)
+	, m_scratchOldPosition(nullptr)
+	, m_scratchVelocity(nullptr)
+	, m_scratchAcceleration(nullptr)
+	, m_scratchFlags(nullptr)
+	, m_count(0u)
+	, m_capacity(0u)
+	, m_head(0u)
+	, m_capacityMode(CapacityMode::EvictOldest)
+{
+}
+
+ParticleStore::ParticleStore(size_t capacity)
+	: ParticleStore()
+{
+	Reserve(capacity);
+}
+
+ParticleStore::~ParticleStore()
+{
+	Release();
+}
+
+void ParticleStore::Reserve(size_t capacity)
+{
+	if (capacity <= m_capacity)
+	{
+		return;
+	}
+
+	//A wrapped ring is unrolled first, the new capacity gives it room to grow at the back
+	Rotate(m_head);
+
+	AlignedFree(m_scratchPosition);
+	AlignedFree(m_scratchOldPosition);
+	AlignedFree(m_scratchVelocity);
+	AlignedFree(m_scratchAcceleration);
+	AlignedFree(m_scratchFlags);
+
+	glm::vec2* position = m_position;
+	glm::vec2* oldPosition = m_oldPosition;
+	glm::vec2* velocity = m_velocity;
+	glm::vec2* acceleration = m_acceleration;
+	uint8_t* flags = m_flags;
+
+	Allocate(capacity);
+
+	if (m_count > 0u)
+	{
+		std::memcpy(m_position, position, m_count * sizeof(glm::vec2));
+		std::memcpy(m_oldPosition, oldPosition, m_count * sizeof(glm::vec2));
+		std::memcpy(m_velocity, velocity, m_count * sizeof(glm::vec2));
+		std::memcpy(m_acceleration, acceleration, m_count * sizeof(glm::vec2));
+		std::memcpy(m_flags, flags, m_count * sizeof(uint8_t));
+	}
+
+	AlignedFree(position);
+	AlignedFree(oldPosition);
+	AlignedFree(velocity);
+	AlignedFree(acceleration);
+	AlignedFree(flags);
+}
+
+void ParticleStore::Clear()
+{
+	m_count = 0u;
+	m_head = 0u;
+}
+
+size_t ParticleStore::Assign(size_t count, const glm::vec2* position, const glm::vec2* oldPosition, const glm::vec2* velocity, const glm::vec2* acceleration, const uint8_t* flags)
+{
+	Clear();
+
+	const size_t kept = std::min(count, m_capacity);
+	const size_t first = m_capacityMode == CapacityMode::EvictOldest ? count - kept : 0u;
+	if (kept > 0u)
+	{
+		std::memcpy(m_position, position + first, kept * sizeof(glm::vec2));
+		std::memcpy(m_oldPosition, oldPosition + first, kept * sizeof(glm::vec2));
+		std::memcpy(m_velocity, velocity + first, kept * sizeof(glm::vec2));
+		std::memcpy(m_acceleration, acceleration + first, kept * sizeof(glm::vec2));
+		std::memcpy(m_flags, flags + first, kept * sizeof(uint8_t));
+	}
+	m_count = kept;
+	return kept;
+}
+
+size_t ParticleStore::Add(const glm::vec2& position, const glm::vec2& velocity)
+{
+	size_t index;
+
+	if (m_count < m_capacity)
+	{
+		index = m_count++;
+	}
+	else if (m_capacityMode == CapacityMode::EvictOldest && m_capacity > 0u)
+	{
+		//Overwrite the oldest particle in place instead of shifting the whole store
+		index = m_head;
+		m_head = m_head + 1u == m_capacity ? 0u : m_head + 1u;
+	}
+	else
+	{
+		return invalidIndex;
+	}
+
+	m_position[index] = position;
+	m_oldPosition[index] = position;
+	m_velocity[index] = velocity;
+	m_acceleration[index] = glm::vec2(0.0f);
+	m_flags[index] = ParticleFlags::None;
+
+	return index;
+}
+
+size_t ParticleStore::Claim(size_t count, Run runs[2])
+{
+	size_t runCount = 0u;
+
+	//Free slots at the end first
+	const size_t appended = std::min(count, m_capacity - m_count);
+	if (appended > 0u)
+	{
+		runs[runCount].first = m_count;
+		runs[runCount].count = appended;
+		++runCount;
+		m_count += appended;
+	}
+
+	if (m_capacityMode != CapacityMode::EvictOldest || appended == count)
+	{
+		return runCount;
+	}
+
+	//Then overwrite the oldest, never more than the ring holds. Until the ring is full the head is 0,
+	//so together with the appended run this still makes at most two runs.
+	size_t evicted = std::min(count - appended, m_capacity - appended);
+	while (evicted > 0u && runCount < 2u)
+	{
+		const size_t run = std::min(evicted, m_capacity - m_head);
+
+		runs[runCount].first = m_head;
+		runs[runCount].count = run;
+		++runCount;
+
+		m_head = m_head + run == m_capacity ? 0u : m_head + run;
+		evicted -= run;
+	}
+
+	return runCount;
+}
+
+void ParticleStore::InitializeRun(const Run& run)
+{
+	std::memcpy(m_oldPosition + run.first, m_position + run.first, run.count * sizeof(glm::vec2));
+	std::fill(m_acceleration + run.first, m_acceleration + run.first + run.count, glm::vec2(0.0f));
+	std::memset(m_flags + run.first, ParticleFlags::None, run.count);
+}
+
+//Removes every particle flagged ToBeDeleted in a single stable pass and returns how many were removed.
+//Afterwards the oldest surviving particle is at index 0 again. Large stores are split across jobs if given.
+size_t ParticleStore::Compact(JobSystem* jobs)
+{
+	if (jobs != nullptr && jobs->GetWorkerCount() > 1u && m_count > compactionChunkSize)
+	{
+		return CompactParallel(*jobs);
+	}
+
+	return CompactSerial();
+}
+
+size_t ParticleStore::CompactSerial()
+{
+	size_t write = 0u;
+	size_t head = 0u;
+
+	for (size_t read = 0u; read < m_count; ++read)
+	{
+		if (read == m_head)
+		{
+			head = write;
+		}
+
+		if (m_flags[read] & ParticleFlags::ToBeDeleted)
+		{
+			continue;
+		}
+
+		if (write != read)
+		{
+			m_position[write] = m_position[read];
+			m_oldPosition[write] = m_oldPosition[read];
+			m_velocity[write] = m_velocity[read];
+			m_acceleration[write] = m_acceleration[read];
+			m_flags[write] = m_flags[read];
+		}
+		++write;
+	}
+
+	size_t removed = m_count - write;
+	m_count = write;
+
+	if (removed > 0u)
+	{
+		Rotate(head);
+	}
+
+	return removed;
+}
+
+size_t ParticleStore::CompactParallel(JobSystem& jobs)
+{
+	if (m_scratchPosition == nullptr)
+	{
+		AllocateArrays(m_capacity, m_scratchPosition, m_scratchOldPosition, m_scratchVelocity, m_scratchAcceleration, m_scratchFlags);
+	}
+
+	const size_t chunkCount = (m_count + compactionChunkSize - 1u) / compactionChunkSize;
+	std::vector<size_t> offsets(chunkCount + 1u, 0u);
+
+	//Count survivors per chunk, walking the ring from its oldest particle
+	jobs.ParallelFor(m_count, compactionChunkSize, [&](size_t begin, size_t end, size_t)
+	{
+		size_t survivors = 0u;
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			survivors += (m_flags[Physical(i, m_head, m_count)] & ParticleFlags::ToBeDeleted) ? 0u : 1u;
+		}
+
+		offsets[begin / compactionChunkSize + 1u] = survivors;
+	});
+
+	for (size_t c = 0u; c < chunkCount; ++c)
+	{
+		offsets[c + 1u] += offsets[c];
+	}
+
+	//Scatter every chunk to its exclusive prefix offset
+	jobs.ParallelFor(m_count, compactionChunkSize, [&](size_t begin, size_t end, size_t)
+	{
+		size_t write = offsets[begin / compactionChunkSize];
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			const size_t read = Physical(i, m_head, m_count);
+
+			if (m_flags[read] & ParticleFlags::ToBeDeleted)
+			{
+				continue;
+			}
+
+			m_scratchPosition[write] = m_position[read];
+			m_scratchOldPosition[write] = m_oldPosition[read];
+			m_scratchVelocity[write] = m_velocity[read];
+			m_scratchAcceleration[write] = m_acceleration[read];
+			m_scratchFlags[write] = m_flags[read];
+			++write;
+		}
+	});
+
+	std::swap(m_position, m_scratchPosition);
+	std::swap(m_oldPosition, m_scratchOldPosition);
+	std::swap(m_velocity, m_scratchVelocity);
+	std::swap(m_acceleration, m_scratchAcceleration);
+	std::swap(m_flags, m_scratchFlags);
+
+	size_t removed = m_count - offsets[chunkCount];
+	m_count = offsets[chunkCount];
+	m_head = 0u;
+
+	return removed;
+}
+
+//Brings the particle at first to index 0, keeping the oldest first order
+void ParticleStore::Rotate(size_t first)
+{
+	if (first != 0u && first < m_count)
+	{
+		std::rotate(m_position, m_position + first, m_position + m_count);
+		std::rotate(m_oldPosition, m_oldPosition + first, m_oldPosition + m_count);
+		std::rotate(m_velocity, m_velocity + first, m_velocity + m_count);
+		std::rotate(m_acceleration, m_acceleration + first, m_acceleration + m_count);
+		std::rotate(m_flags, m_flags + first, m_flags + m_count);
+	}
+
+	m_head = 0u;
+}
+
+void ParticleStore::Allocate(size_t capacity)
+{
+	//Throws before anything changes, a store that failed to grow keeps its old arrays and capacity
+	AllocateArrays(capacity, m_position, m_oldPosition, m_velocity, m_acceleration, m_flags);
+	m_capacity = capacity;
+}
+
+void ParticleStore::Release()
+{
+	AlignedFree(m_position);
+	AlignedFree(m_oldPosition);
+	AlignedFree(m_velocity);
+	AlignedFree(m_acceleration);
+	AlignedFree(m_flags);
+	AlignedFree(m_scratchPosition);
+	AlignedFree(m_scratchOldPosition);
+	AlignedFree(m_scratchVelocity);
+	AlignedFree(m_scratchAcceleration);
+	AlignedFree(m_scratchFlags);
+	m_count = 0u;
+	m_capacity = 0u;
+	m_head = 0u;
+}
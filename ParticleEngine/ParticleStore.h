@@ -0,0 +1,152 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cstddef>
+
+class JobSystem;
+
+namespace ParticleFlags
+{
+	const static uint8_t None = 0u;
+	const static uint8_t ToBeDeleted = 1u << 0;
+	const static uint8_t Sleeping = 1u << 1;
+	const static uint8_t Contact = 1u << 2; //Touched static geometry during the current step
+
+	//The upper bits count the consecutive steps a particle has been resting, saturating at RestLimit
+	const static uint8_t RestShift = 3u;
+	const static uint8_t RestMask = 0xF8u;
+	const static uint8_t RestLimit = RestMask >> RestShift;
+}
+
+//Shared by every particle in a store, so it is kept once instead of per particle
+struct ParticleMaterial
+{
+	ParticleMaterial();
+
+	float mass;
+	float inverseMass;
+	float bounciness;
+	float staticFriction;
+	float kinematicFriction;
+};
+
+//Structure of arrays storage for the light weight particles.
+//Each attribute lives in its own contiguous, cache line aligned array so that
+//every pass only streams the attributes it actually touches.
+class ParticleStore
+{
+public:
+	const static size_t alignment = 64u;
+	const static size_t invalidIndex = static_cast<size_t>(-1);
+	const static size_t compactionChunkSize = 8192u;
+
+	enum class CapacityMode
+	{
+		EvictOldest,	//Ring buffer, a full store overwrites its oldest particle
+		DropNewest		//A full store rejects new particles
+	};
+
+	ParticleStore();
+	explicit ParticleStore(size_t capacity);
+	~ParticleStore();
+
+	//Throws std::bad_alloc if the arrays do not fit, the store then keeps its particles and old capacity
+	void Reserve(size_t capacity);
+	void Clear();
+
+	size_t Add(const glm::vec2& position, const glm::vec2& velocity);
+
+	//Claims up to count slots at once and lets the caller write them in place.
+	//emit(position, velocity, runCount, batchOffset) is called once per contiguous run, at most twice since
+	//a wrapped ring splits the range at the end of the arrays. batchOffset is the index of the run's first particle
+	//within the batch. If the batch does not fit, DropNewest keeps its start and EvictOldest its newest end, like
+	//count calls to Add would. The remaining attributes are initialized afterwards. Returns how many were added.
+	template<typename Emit>
+	size_t AddParticles(size_t count, Emit emit)
+	{
+		Run runs[2];
+		const size_t runCount = Claim(count, runs);
+
+		size_t added = 0u;
+		for (size_t r = 0u; r < runCount; ++r)
+		{
+			added += runs[r].count;
+		}
+
+		size_t offset = m_capacityMode == CapacityMode::EvictOldest ? count - added : 0u;
+		for (size_t r = 0u; r < runCount; ++r)
+		{
+			emit(m_position + runs[r].first, m_velocity + runs[r].first, runs[r].count, offset);
+			InitializeRun(runs[r]);
+			offset += runs[r].count;
+		}
+
+		return added;
+	}
+
+	size_t Compact(JobSystem* jobs);
+
+	//Replaces the contents with count particles copied from the given arrays, oldest first. The capacity stays, if they do not fit
+	//DropNewest keeps their start and EvictOldest their newest end, like AddParticles. Returns how many were kept.
+	size_t Assign(size_t count, const glm::vec2* position, const glm::vec2* oldPosition, const glm::vec2* velocity, const glm::vec2* acceleration, const uint8_t* flags);
+
+	void SetCapacityMode(CapacityMode mode) { m_capacityMode = mode; }
+	CapacityMode GetCapacityMode() const { return m_capacityMode; }
+
+	size_t Size() const { return m_count; }
+	size_t Capacity() const { return m_capacity; }
+	bool Empty() const { return m_count == 0u; }
+	bool Full() const { return m_count == m_capacity; }
+	//Slot of the oldest particle, the arrays hold [Head(), Size()) followed by [0, Head())
+	size_t Head() const { return m_head; }
+
+	glm::vec2* Positions() { return m_position; }
+	glm::vec2* OldPositions() { return m_oldPosition; }
+	glm::vec2* Velocities() { return m_velocity; }
+	glm::vec2* Accelerations() { return m_acceleration; }
+	uint8_t* Flags() { return m_flags; }
+
+	const glm::vec2* Positions() const { return m_position; }
+	const glm::vec2* OldPositions() const { return m_oldPosition; }
+	const glm::vec2* Velocities() const { return m_velocity; }
+	const glm::vec2* Accelerations() const { return m_acceleration; }
+	const uint8_t* Flags() const { return m_flags; }
+
+	ParticleMaterial material;
+
+private:
+	struct Run
+	{
+		size_t first;
+		size_t count;
+	};
+
+	ParticleStore(const ParticleStore& other);
+	ParticleStore& operator=(const ParticleStore& other);
+
+	void Allocate(size_t capacity);
+	void Release();
+	size_t CompactSerial();
+	size_t CompactParallel(JobSystem& jobs);
+	void Rotate(size_t first);
+	size_t Claim(size_t count, Run runs[2]);
+	void InitializeRun(const Run& run);
+
+	glm::vec2* m_position;
+	glm::vec2* m_oldPosition;
+	glm::vec2* m_velocity;
+	glm::vec2* m_acceleration;
+	uint8_t* m_flags;
+
+	//Compaction targets for the parallel path, swapped with the live arrays afterwards
+	glm::vec2* m_scratchPosition;
+	glm::vec2* m_scratchOldPosition;
+	glm::vec2* m_scratchVelocity;
+	glm::vec2* m_scratchAcceleration;
+	uint8_t* m_scratchFlags;
+
+	size_t m_count;
+	size_t m_capacity;
+	size_t m_head; //Oldest particle once the ring buffer has wrapped
+	CapacityMode m_capacityMode;
+};
@@ -0,0 +1,238 @@
+#include "Profiler.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <memory>
+
+namespace
+{
+	//Relaxed atomics only so a dump racing the writer reads stale values instead of undefined ones
+	struct Slot
+	{
+		std::atomic<const char*> name;
+		std::atomic<uint64_t> start;
+		std::atomic<uint64_t> end;
+	};
+
+	//Single writer ring. The reader copies a window and afterwards drops every slot the writer may have
+	//overwritten in the meantime, so neither side ever waits for the other.
+	struct ThreadRing
+	{
+		ThreadRing() : written(0u), owned(true) {}
+
+		Slot events[Profiler::eventsPerThread];
+		std::atomic<uint64_t> written;
+		std::atomic<bool> owned;
+	};
+
+	std::atomic<ThreadRing*> g_rings[Profiler::maxThreads];
+	std::atomic<size_t> g_ringCount(0u);
+	std::atomic<bool> g_enabled(true);
+
+	const std::chrono::steady_clock::time_point g_epoch = std::chrono::steady_clock::now();
+
+	//Hands the ring back when its thread exits, the next new thread picks it up again
+	//so short lived worker pools do not use up the slots
+	struct RingOwner
+	{
+		RingOwner() : ring(nullptr), registered(false) {}
+		~RingOwner()
+		{
+			if (ring)
+			{
+				ring->owned.store(false, std::memory_order_release);
+			}
+		}
+
+		ThreadRing* ring;
+		bool registered;
+	};
+
+	thread_local RingOwner t_owner;
+
+	ThreadRing* GetThreadRing()
+	{
+		if (t_owner.registered)
+		{
+			return t_owner.ring;
+		}
+		t_owner.registered = true;
+
+		const size_t ringCount = std::min(g_ringCount.load(), Profiler::maxThreads);
+		for (size_t i = 0u; i < ringCount; ++i)
+		{
+			ThreadRing* ring = g_rings[i].load(std::memory_order_acquire);
+			bool owned = false;
+			if (ring && ring->owned.compare_exchange_strong(owned, true))
+			{
+				t_owner.ring = ring;
+				return ring;
+			}
+		}
+
+		//Threads past the limit simply do not record
+		const size_t slot = g_ringCount.fetch_add(1u);
+		if (slot < Profiler::maxThreads)
+		{
+			t_owner.ring = new ThreadRing();
+			g_rings[slot].store(t_owner.ring, std::memory_order_release);
+		}
+
+		return t_owner.ring;
+	}
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+	g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Profiler::IsEnabled()
+{
+	return g_enabled.load(std::memory_order_relaxed);
+}
+
+uint64_t Profiler::Now()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_epoch).count());
+}
+
+void Profiler::Record(const char* name, uint64_t start, uint64_t end)
+{
+	if (!IsEnabled())
+	{
+		return;
+	}
+
+	ThreadRing* ring = GetThreadRing();
+	if (!ring)
+	{
+		return;
+	}
+
+	const uint64_t index = ring->written.load(std::memory_order_relaxed);
+
+	Slot& slot = ring->events[index & (eventsPerThread - 1u)];
+	slot.name.store(name, std::memory_order_relaxed);
+	slot.start.store(start, std::memory_order_relaxed);
+	slot.end.store(end, std::memory_order_relaxed);
+
+	ring->written.store(index + 1u, std::memory_order_release);
+}
+
+bool Profiler::WriteChromeTrace(const char* path)
+{
+	FILE* file = std::fopen(path, "w");
+	if (!file)
+	{
+		return false;
+	}
+
+	std::unique_ptr<Event[]> copy(new Event[eventsPerThread]);
+	bool first = true;
+
+	std::fprintf(file, "{\"traceEvents\":[\n");
+
+	const size_t ringCount = std::min(g_ringCount.load(), maxThreads);
+	for (size_t t = 0u; t < ringCount; ++t)
+	{
+		const ThreadRing* ring = g_rings[t].load(std::memory_order_acquire);
+		if (!ring)
+		{
+			continue;
+		}
+
+		const uint64_t end = ring->written.load(std::memory_order_acquire);
+		const uint64_t begin = end > eventsPerThread ? end - eventsPerThread : 0u;
+
+		for (uint64_t i = begin; i < end; ++i)
+		{
+			const Slot& slot = ring->events[i & (eventsPerThread - 1u)];
+			copy[i - begin].name = slot.name.load(std::memory_order_relaxed);
+			copy[i - begin].start = slot.start.load(std::memory_order_relaxed);
+			copy[i - begin].end = slot.end.load(std::memory_order_relaxed);
+		}
+
+		//Everything the writer lapped while copying is unreliable
+		const uint64_t written = ring->written.load(std::memory_order_acquire);
+		const uint64_t firstValid = std::max(begin, written > eventsPerThread ? written - eventsPerThread : 0u);
+
+		std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%zu,\"args\":{\"name\":\"thread %zu\"}}", first ? "" : ",\n", t, t);
+		first = false;
+
+		for (uint64_t i = firstValid; i < end; ++i)
+		{
+			const Event& event = copy[i - begin];
+			std::fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f}",
+				event.name, t, static_cast<double>(event.start) / 1000.0, static_cast<double>(event.end - event.start) / 1000.0);
+		}
+	}
+
+	std::fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	return std::fclose(file) == 0;
+}
+
+Profiler::ScopedTimer::ScopedTimer(const char* name, double* duration)
+	: m_name(name)
+	, m_duration(duration)
+	, m_start(Now())
+{
+}
+
+Profiler::ScopedTimer::~ScopedTimer()
+{
+	const uint64_t end = Now();
+
+	if (m_duration)
+	{
+		*m_duration = static_cast<double>(end - m_start);
+	}
+
+	Record(m_name, m_start, end);
+}
+
+Profiler::FrameHistogram::FrameHistogram(float bucketMilliseconds, float maxMilliseconds)
+	: m_bucketMilliseconds(bucketMilliseconds)
+	, m_count(0u)
+{
+	//One extra bucket collects everything above the range
+	m_buckets.resize(static_cast<size_t>(maxMilliseconds / bucketMilliseconds) + 1u, 0u);
+}
+
+void Profiler::FrameHistogram::Add(float milliseconds)
+{
+	const size_t bucket = static_cast<size_t>(std::max(milliseconds, 0.0f) / m_bucketMilliseconds);
+	++m_buckets[std::min(bucket, m_buckets.size() - 1u)];
+	++m_count;
+}
+
+void Profiler::FrameHistogram::Reset()
+{
+	std::fill(m_buckets.begin(), m_buckets.end(), 0u);
+	m_count = 0u;
+}
+
+float Profiler::FrameHistogram::GetPercentile(float percentile) const
+{
+	if (m_count == 0u)
+	{
+		return 0.0f;
+	}
+
+	//Rank of the frame the percentile points at, one based
+	const size_t rank = std::max<size_t>(1u, static_cast<size_t>(std::ceil(percentile * static_cast<float>(m_count))));
+
+	size_t seen = 0u;
+	for (size_t i = 0u; i < m_buckets.size(); ++i)
+	{
+		seen += m_buckets[i];
+		if (seen >= rank)
+		{
+			return static_cast<float>(i + 1u) * m_bucketMilliseconds;
+		}
+	}
+
+	return static_cast<float>(m_buckets.size()) * m_bucketMilliseconds;
+}
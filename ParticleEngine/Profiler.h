@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+//Scoped wall clock timers for the engine phases.
+//Every thread records into its own fixed size ring buffer, recording never locks and never allocates
+//after the first event of a thread. Old events are overwritten once a ring is full.
+namespace Profiler
+{
+	struct Event
+	{
+		const char* name; //Has to outlive the profiler, string literals only
+		uint64_t start;   //Nanoseconds since the profiler started
+		uint64_t end;
+	};
+
+	//Events each thread keeps before the oldest are overwritten
+	const static size_t eventsPerThread = 1u << 15;
+	const static size_t maxThreads = 64u;
+
+	void SetEnabled(bool enabled);
+	bool IsEnabled();
+
+	uint64_t Now();
+	void Record(const char* name, uint64_t start, uint64_t end);
+
+	//Writes every event still held by the rings in the Chrome trace event format (chrome://tracing, Perfetto),
+	//safe to call while other threads keep recording
+	bool WriteChromeTrace(const char* path);
+
+	class ScopedTimer
+	{
+	public:
+		//duration receives the elapsed nanoseconds on destruction, even with recording disabled
+		explicit ScopedTimer(const char* name, double* duration = nullptr);
+		~ScopedTimer();
+
+	private:
+		ScopedTimer(const ScopedTimer& other);
+		ScopedTimer& operator=(const ScopedTimer& other);
+
+		const char* m_name;
+		double* m_duration;
+		uint64_t m_start;
+	};
+
+	//Fixed resolution histogram for frame times, percentiles are exact to one bucket width
+	class FrameHistogram
+	{
+	public:
+		FrameHistogram(float bucketMilliseconds = 0.05f, float maxMilliseconds = 250.0f);
+
+		void Add(float milliseconds);
+		void Reset();
+
+		size_t GetCount() const { return m_count; }
+		//Upper edge of the bucket holding the given fraction of frames, percentile in [0, 1]
+		float GetPercentile(float percentile) const;
+
+	private:
+		std::vector<uint32_t> m_buckets;
+		float m_bucketMilliseconds;
+		size_t m_count;
+	};
+}
@@ -0,0 +1,228 @@
+#include "RandomStream.h"
+#include <vector>
+
+#if PARTICLE_ENGINE_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	const uint64_t golden = 0x9E3779B97F4A7C15ull;
+	const uint64_t mix1 = 0xBF58476D1CE4E5B9ull;
+	const uint64_t mix2 = 0x94D049BB133111EBull;
+	const float floatScale = 1.0f / 16777216.0f;
+
+	uint64_t Mix(uint64_t z)
+	{
+		z = (z ^ (z >> 30)) * mix1;
+		z = (z ^ (z >> 27)) * mix2;
+		return z ^ (z >> 31);
+	}
+
+	uint64_t ValueAt(uint64_t key, uint64_t counter)
+	{
+		return Mix(key + (counter + 1u) * golden);
+	}
+
+	float ToFloat(uint64_t value)
+	{
+		return static_cast<float>(static_cast<uint32_t>(value >> 40)) * floatScale;
+	}
+
+	void FillFloatsScalar(uint64_t key, uint64_t counter, float* values, size_t count)
+	{
+		for (size_t i = 0u; i < count; ++i)
+		{
+			values[i] = ToFloat(ValueAt(key, counter + i));
+		}
+	}
+
+#if PARTICLE_ENGINE_X86
+	//Low 64 bits of a 64 bit product per lane, SSE2 only multiplies 32 bit halves
+	__m128i Mul64(__m128i a, __m128i b)
+	{
+		const __m128i low = _mm_mul_epu32(a, b);
+		const __m128i cross = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), b), _mm_mul_epu32(a, _mm_srli_epi64(b, 32)));
+		return _mm_add_epi64(low, _mm_slli_epi64(cross, 32));
+	}
+
+	__m128i Mix(__m128i z, __m128i m1, __m128i m2)
+	{
+		z = Mul64(_mm_xor_si128(z, _mm_srli_epi64(z, 30)), m1);
+		z = Mul64(_mm_xor_si128(z, _mm_srli_epi64(z, 27)), m2);
+		return _mm_xor_si128(z, _mm_srli_epi64(z, 31));
+	}
+
+	//Four values per iteration from two registers of two lanes each
+	size_t FillFloatsSSE2(uint64_t key, uint64_t counter, float* values, size_t count)
+	{
+		const __m128i m1 = _mm_set1_epi64x(static_cast<long long>(mix1));
+		const __m128i m2 = _mm_set1_epi64x(static_cast<long long>(mix2));
+		const __m128i step = _mm_set1_epi64x(static_cast<long long>(golden * 4u));
+		const __m128 scale = _mm_set1_ps(floatScale);
+
+		__m128i stateLow = _mm_set_epi64x(static_cast<long long>(key + (counter + 2u) * golden), static_cast<long long>(key + (counter + 1u) * golden));
+		__m128i stateHigh = _mm_set_epi64x(static_cast<long long>(key + (counter + 4u) * golden), static_cast<long long>(key + (counter + 3u) * golden));
+
+		size_t i = 0u;
+		for (; i + 4u <= count; i += 4u)
+		{
+			const __m128i low = _mm_srli_epi64(Mix(stateLow, m1, m2), 40);
+			const __m128i high = _mm_srli_epi64(Mix(stateHigh, m1, m2), 40);
+
+			//The 24 bit results sit in the even dwords, gather them into one register
+			const __m128i packed = _mm_unpacklo_epi64(_mm_shuffle_epi32(low, _MM_SHUFFLE(3, 1, 2, 0)), _mm_shuffle_epi32(high, _MM_SHUFFLE(3, 1, 2, 0)));
+			_mm_storeu_ps(values + i, _mm_mul_ps(_mm_cvtepi32_ps(packed), scale));
+
+			stateLow = _mm_add_epi64(stateLow, step);
+			stateHigh = _mm_add_epi64(stateHigh, step);
+		}
+
+		return i;
+	}
+
+	PARTICLE_ENGINE_TARGET_AVX2
+	__m256i Mul64(__m256i a, __m256i b)
+	{
+		const __m256i low = _mm256_mul_epu32(a, b);
+		const __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b), _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+		return _mm256_add_epi64(low, _mm256_slli_epi64(cross, 32));
+	}
+
+	PARTICLE_ENGINE_TARGET_AVX2
+	__m256i Mix(__m256i z, __m256i m1, __m256i m2)
+	{
+		z = Mul64(_mm256_xor_si256(z, _mm256_srli_epi64(z, 30)), m1);
+		z = Mul64(_mm256_xor_si256(z, _mm256_srli_epi64(z, 27)), m2);
+		return _mm256_xor_si256(z, _mm256_srli_epi64(z, 31));
+	}
+
+	//Eight values per iteration from two registers of four lanes each
+	PARTICLE_ENGINE_TARGET_AVX2
+	size_t FillFloatsAVX2(uint64_t key, uint64_t counter, float* values, size_t count)
+	{
+		const __m256i m1 = _mm256_set1_epi64x(static_cast<long long>(mix1));
+		const __m256i m2 = _mm256_set1_epi64x(static_cast<long long>(mix2));
+		const __m256i step = _mm256_set1_epi64x(static_cast<long long>(golden * 8u));
+		const __m256i evenDwords = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+		const __m256 scale = _mm256_set1_ps(floatScale);
+
+		__m256i stateLow = _mm256_setr_epi64x(
+			static_cast<long long>(key + (counter + 1u) * golden), static_cast<long long>(key + (counter + 2u) * golden),
+			static_cast<long long>(key + (counter + 3u) * golden), static_cast<long long>(key + (counter + 4u) * golden));
+		__m256i stateHigh = _mm256_setr_epi64x(
+			static_cast<long long>(key + (counter + 5u) * golden), static_cast<long long>(key + (counter + 6u) * golden),
+			static_cast<long long>(key + (counter + 7u) * golden), static_cast<long long>(key + (counter + 8u) * golden));
+
+		size_t i = 0u;
+		for (; i + 8u <= count; i += 8u)
+		{
+			const __m256i low = _mm256_permutevar8x32_epi32(_mm256_srli_epi64(Mix(stateLow, m1, m2), 40), evenDwords);
+			const __m256i high = _mm256_permutevar8x32_epi32(_mm256_srli_epi64(Mix(stateHigh, m1, m2), 40), evenDwords);
+
+			const __m256i packed = _mm256_permute2x128_si256(low, high, 0x20);
+			_mm256_storeu_ps(values + i, _mm256_mul_ps(_mm256_cvtepi32_ps(packed), scale));
+
+			stateLow = _mm256_add_epi64(stateLow, step);
+			stateHigh = _mm256_add_epi64(stateHigh, step);
+		}
+
+		return i;
+	}
+#endif
+}
+
+RandomStream::RandomStream(uint64_t seed, uint64_t stream)
+{
+	Seed(seed, stream);
+}
+
+void RandomStream::Seed(uint64_t seed, uint64_t stream)
+{
+	m_key = Mix(seed ^ Mix(stream + golden));
+	m_counter = 0u;
+}
+
+uint64_t RandomStream::NextU64()
+{
+	return ValueAt(m_key, m_counter++);
+}
+
+uint32_t RandomStream::NextU32()
+{
+	return static_cast<uint32_t>(NextU64() >> 32);
+}
+
+float RandomStream::NextFloat()
+{
+	return ToFloat(NextU64());
+}
+
+float RandomStream::NextFloat(float min, float max)
+{
+	return min + (max - min) * NextFloat();
+}
+
+int RandomStream::NextInt(int min, int max)
+{
+	//Fixed point scaling instead of modulo, the bias is below 2^-32 for any realistic range
+	const uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(max) - static_cast<int64_t>(min)) + 1u;
+	return static_cast<int>(static_cast<int64_t>(min) + static_cast<int64_t>((static_cast<uint64_t>(NextU32()) * range) >> 32));
+}
+
+void RandomStream::FillFloats(float* values, size_t count)
+{
+	FillFloats(SimdSupport::GetActive(), values, count);
+}
+
+void RandomStream::FillFloats(SimdSupport::InstructionSet set, float* values, size_t count)
+{
+	size_t done = 0u;
+
+#if PARTICLE_ENGINE_X86
+	if (set == SimdSupport::InstructionSet::AVX2)
+	{
+		done = FillFloatsAVX2(m_key, m_counter, values, count);
+	}
+	else if (set == SimdSupport::InstructionSet::SSE2)
+	{
+		done = FillFloatsSSE2(m_key, m_counter, values, count);
+	}
+#endif
+
+	FillFloatsScalar(m_key, m_counter + done, values + done, count - done);
+	m_counter += count;
+}
+
+bool RandomStream::Verify()
+{
+	//Odd count and counter offset so the tails and lane setup are covered as well
+	const size_t count = 1037u;
+
+	RandomStream reference(12345u, 7u);
+	reference.Skip(3u);
+	std::vector<float> expected(count);
+	reference.FillFloats(SimdSupport::InstructionSet::Scalar, &expected[0], count);
+
+	const SimdSupport::InstructionSet sets[] = { SimdSupport::InstructionSet::SSE2, SimdSupport::InstructionSet::AVX2 };
+	for (size_t s = 0u; s < 2u; ++s)
+	{
+		if (sets[s] > SimdSupport::Detect())
+		{
+			continue;
+		}
+
+		RandomStream stream(12345u, 7u);
+		stream.Skip(3u);
+		std::vector<float> actual(count);
+		stream.FillFloats(sets[s], &actual[0], count);
+
+		if (actual != expected || stream.GetCounter() != reference.GetCounter())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
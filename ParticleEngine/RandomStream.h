@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include "SimdSupport.h"
+
+//Counter based random numbers after SplitMix64. Value n of a stream is a pure function of (seed, stream, n),
+//so streams never share state, any thread can jump to any position and a batch split over several
+//workers yields exactly the values a single serial loop would.
+class RandomStream
+{
+public:
+	explicit RandomStream(uint64_t seed = 0u, uint64_t stream = 0u);
+
+	//Different streams of one seed are independent, emitters use their index as stream
+	void Seed(uint64_t seed, uint64_t stream = 0u);
+
+	uint64_t GetCounter() const { return m_counter; }
+	void SetCounter(uint64_t counter) { m_counter = counter; }
+	void Skip(uint64_t count) { m_counter += count; }
+
+	uint64_t NextU64();
+	uint32_t NextU32();
+	//[0, 1) with 24 bits of resolution
+	float NextFloat();
+	float NextFloat(float min, float max);
+	//[min, max]
+	int NextInt(int min, int max);
+
+	//Same values as count calls of NextFloat, the counter advances by count
+	void FillFloats(float* values, size_t count);
+	void FillFloats(SimdSupport::InstructionSet set, float* values, size_t count);
+
+	//Runs every supported vector fill against the scalar one, true if all match bit for bit
+	static bool Verify();
+
+private:
+	uint64_t m_key;
+	uint64_t m_counter;
+};
@@ -0,0 +1,274 @@
+#include "Scene.h"
+#include "Config.hpp"
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	//Unsigned amount, reading a size_t directly would wrap a leading minus around to a huge value
+	struct Count
+	{
+		size_t value;
+	};
+
+	std::istream& operator>>(std::istream& stream, Count& count)
+	{
+		if ((stream >> std::ws).peek() == '-')
+		{
+			stream.setstate(std::ios::failbit);
+			return stream;
+		}
+		return stream >> count.value;
+	}
+
+	bool Fail(std::string* error, size_t line, const std::string& message)
+	{
+		if (error)
+		{
+			*error = "line " + std::to_string(line) + ": " + message;
+		}
+		return false;
+	}
+
+	//Reads all arguments and makes sure nothing but whitespace follows them
+	template<typename... Values>
+	bool ReadArguments(std::istringstream& stream, Values&... values)
+	{
+		bool valid = true;
+		const bool read[] = { true, (valid = valid && static_cast<bool>(stream >> values))... };
+		(void)read;
+
+		std::string rest;
+		return valid && !(stream >> rest);
+	}
+
+	//Optional last argument, value keeps its default if the line ends before it
+	template<typename Value>
+	bool ReadOptional(std::istringstream& stream, Value& value)
+	{
+		std::string token;
+		if (!(stream >> token))
+		{
+			return true;
+		}
+
+		std::istringstream parsed(token);
+		return ReadArguments(parsed, value) && ReadArguments(stream);
+	}
+
+	Solid MakeSolid(const glm::vec2& position, const glm::vec2& size, float rotation)
+	{
+		Solid solid;
+		solid.SetSize(size);
+		solid.SetRotation(rotation);
+		solid.SetPosition(position);
+		return solid;
+	}
+}
+
+SceneDescription::SceneDescription()
+	: particleCapacity(Config::maxParticleCount)
+	, ballCapacity(Config::maxBallCount)
+	, particleCapacityMode(ParticleStore::CapacityMode::EvictOldest)
+	, seed(0u)
+{
+}
+
+SceneDescription SceneDescription::Default()
+{
+	const float width = static_cast<float>(Config::width);
+	const float height = static_cast<float>(Config::height);
+
+	SceneDescription scene;
+
+	//Center and bottom left platform
+	scene.solids.push_back(MakeSolid(glm::vec2(width * 0.5f, height * 0.5f), glm::vec2(width * 0.3f, height * 0.05f), 15.0f));
+	scene.solids.push_back(MakeSolid(glm::vec2(width * 0.0f, height), glm::vec2(width * 0.3f, height * 0.4f), 45.0f));
+
+	//Left and right wall
+	scene.solids.push_back(MakeSolid(glm::vec2(width * -0.2f, height * 0.5f), glm::vec2(width * 0.45f, height), 0.0f));
+	scene.solids.push_back(MakeSolid(glm::vec2(width * 1.2f, height * 0.5f), glm::vec2(width * 0.45f, height), 0.0f));
+
+	//Floor and ceiling
+	scene.solids.push_back(MakeSolid(glm::vec2(width * 0.5f, height * 1.2f), glm::vec2(width, height * 0.45f), 0.0f));
+	scene.solids.push_back(MakeSolid(glm::vec2(width * 0.5f, height * -0.2f), glm::vec2(width, height * 0.45f), 0.0f));
+
+	scene.blizzards.push_back(Blizzard(glm::vec2(width * 0.75f, height * 0.25f), 25u));
+	scene.blizzards.push_back(Blizzard(glm::vec2(width * 0.25f, height * 0.25f), 25u));
+
+	scene.ballGenerators.push_back(BallGenerator(glm::vec2(width * 0.25f, height * 0.15f), glm::vec2(width * 0.75f, height * 0.15f), 10.0f));
+
+	scene.fans.push_back(Fan(glm::vec2(width * 0.95f, height * 0.15f), glm::vec2(width * 0.95f, height * 0.35f), 10.0f));
+	scene.fans.push_back(Fan(glm::vec2(width * 0.95f, height * 0.99f), glm::vec2(width * 0.75f, height * 0.99f), 20.0f));
+
+	Cloth cloth;
+	cloth.columns = Config::clothColumns;
+	cloth.rows = Config::clothRows;
+	cloth.nodeRadius = 10.0f;
+	cloth.position = glm::vec2(width * 0.15f, height * 0.45f);
+	cloth.spacing = 5.0f;
+	scene.cloth.push_back(cloth);
+
+	return scene;
+}
+
+bool SceneFile::Load(const char* path, SceneDescription& scene, std::string* error)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		if (error)
+		{
+			*error = std::string("could not open ") + path;
+		}
+		return false;
+	}
+
+	std::stringstream text;
+	text << file.rdbuf();
+	return Parse(text.str(), scene, error);
+}
+
+bool SceneFile::Parse(const std::string& text, SceneDescription& scene, std::string* error)
+{
+	std::istringstream lines(text);
+	std::string line;
+
+	for (size_t number = 1u; std::getline(lines, line); ++number)
+	{
+		line = line.substr(0u, line.find('#'));
+
+		std::istringstream stream(line);
+		std::string keyword;
+		if (!(stream >> keyword))
+		{
+			continue;
+		}
+
+		if (keyword == "particles")
+		{
+			Count capacity;
+			std::string mode = "evict";
+			if (!(stream >> capacity) || !ReadOptional(stream, mode) || (mode != "evict" && mode != "drop"))
+			{
+				return Fail(error, number, "expected particles <capacity> [evict|drop]");
+			}
+			if (capacity.value > SceneFile::maxParticleCapacity)
+			{
+				return Fail(error, number, "particle capacity has to be at most " + std::to_string(SceneFile::maxParticleCapacity));
+			}
+
+			scene.particleCapacity = capacity.value;
+			scene.particleCapacityMode = mode == "drop" ? ParticleStore::CapacityMode::DropNewest : ParticleStore::CapacityMode::EvictOldest;
+		}
+		else if (keyword == "balls")
+		{
+			Count capacity;
+			if (!ReadArguments(stream, capacity))
+			{
+				return Fail(error, number, "expected balls <capacity>");
+			}
+			if (capacity.value > SceneFile::maxBallCapacity)
+			{
+				return Fail(error, number, "ball capacity has to be at most " + std::to_string(SceneFile::maxBallCapacity));
+			}
+
+			scene.ballCapacity = capacity.value;
+		}
+		else if (keyword == "seed")
+		{
+			if (!ReadArguments(stream, scene.seed))
+			{
+				return Fail(error, number, "expected seed <value>");
+			}
+		}
+		else if (keyword == "solid")
+		{
+			glm::vec2 position;
+			glm::vec2 size;
+			float rotation = 0.0f;
+			if (!(stream >> position.x >> position.y >> size.x >> size.y) || !ReadOptional(stream, rotation))
+			{
+				return Fail(error, number, "expected solid <centerX> <centerY> <width> <height> [rotationDegrees]");
+			}
+			if (size.x <= 0.0f || size.y <= 0.0f)
+			{
+				return Fail(error, number, "solid size has to be positive");
+			}
+
+			scene.solids.push_back(MakeSolid(position, size, rotation));
+		}
+		else if (keyword == "blizzard")
+		{
+			glm::vec2 position;
+			Count spawnCount;
+			if (!ReadArguments(stream, position.x, position.y, spawnCount) || spawnCount.value == 0u)
+			{
+				return Fail(error, number, "expected blizzard <x> <y> <spawnCount>, spawnCount at least 1");
+			}
+			if (spawnCount.value > SceneFile::maxParticleCapacity)
+			{
+				return Fail(error, number, "blizzard spawnCount has to be at most " + std::to_string(SceneFile::maxParticleCapacity));
+			}
+
+			scene.blizzards.push_back(Blizzard(position, spawnCount.value));
+		}
+		else if (keyword == "ballgenerator" || keyword == "fan")
+		{
+			glm::vec2 start;
+			glm::vec2 end;
+			float value;
+			if (!ReadArguments(stream, start.x, start.y, end.x, end.y, value))
+			{
+				return Fail(error, number, "expected " + keyword + " <startX> <startY> <endX> <endY> <" + (keyword == "fan" ? "strength>" : "spawnVelocity>"));
+			}
+			if (start == end)
+			{
+				return Fail(error, number, keyword + " needs distinct start and end points");
+			}
+
+			if (keyword == "fan")
+			{
+				scene.fans.push_back(Fan(start, end, value));
+			}
+			else
+			{
+				scene.ballGenerators.push_back(BallGenerator(start, end, value));
+			}
+		}
+		else if (keyword == "cloth")
+		{
+			SceneDescription::Cloth cloth;
+			Count columns;
+			Count rows;
+			if (!ReadArguments(stream, columns, rows, cloth.nodeRadius, cloth.position.x, cloth.position.y, cloth.spacing))
+			{
+				return Fail(error, number, "expected cloth <columns> <rows> <nodeRadius> <x> <y> <spacing>");
+			}
+			if (columns.value == 0u || rows.value == 0u || cloth.nodeRadius <= 0.0f)
+			{
+				return Fail(error, number, "cloth needs at least one node and a positive node radius");
+			}
+			//Checked by division, columns * rows itself may already wrap
+			if (columns.value > SceneFile::maxClothNodes / rows.value)
+			{
+				return Fail(error, number, "cloth may have at most " + std::to_string(SceneFile::maxClothNodes) + " nodes");
+			}
+
+			cloth.columns = columns.value;
+			cloth.rows = rows.value;
+			if (!scene.cloth.empty())
+			{
+				return Fail(error, number, "a scene holds at most one cloth");
+			}
+
+			scene.cloth.push_back(cloth);
+		}
+		else
+		{
+			return Fail(error, number, "unknown statement " + keyword);
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "ParticleStore.h"
+#include "Solid.h"
+#include "Blizzard.h"
+#include "BallGenerator.h"
+#include "Fan.h"
+
+//Layout and budgets of a scene, built in code or read from a scene file.
+//ParticleEngine(const SceneDescription&) sizes every pool from it once and then adds the bodies.
+struct SceneDescription
+{
+	struct Cloth
+	{
+		size_t columns;
+		size_t rows;
+		float nodeRadius;
+		glm::vec2 position; //Top left node
+		float spacing;		//Gap between neighbouring nodes
+	};
+
+	//Empty scene with the budgets from Config
+	SceneDescription();
+
+	//The scene the application starts with
+	static SceneDescription Default();
+
+	size_t particleCapacity;
+	size_t ballCapacity;
+	ParticleStore::CapacityMode particleCapacityMode;
+	uint64_t seed;
+
+	std::vector<Solid> solids;
+	std::vector<Blizzard> blizzards;
+	std::vector<BallGenerator> ballGenerators;
+	std::vector<Fan> fans;
+	std::vector<Cloth> cloth; //At most one, the engine holds a single cloth
+};
+
+//Plain text scene files, one statement per line, # starts a comment. Positions and sizes are in pixels.
+//	particles <capacity> [evict|drop]
+//	balls <capacity>
+//	seed <value>
+//	solid <centerX> <centerY> <width> <height> [rotationDegrees]
+//	blizzard <x> <y> <spawnCount>
+//	ballgenerator <startX> <startY> <endX> <endY> <spawnVelocity>
+//	fan <startX> <startY> <endX> <endY> <strength>
+//	cloth <columns> <rows> <nodeRadius> <x> <y> <spacing>
+//Counts are unsigned and bounded below, so a typo cannot size a pool beyond what memory holds.
+namespace SceneFile
+{
+	const static size_t maxParticleCapacity = size_t(1u) << 24;	//Also bounds the blizzard spawn count
+	const static size_t maxBallCapacity = size_t(1u) << 16;
+	const static size_t maxClothNodes = size_t(1u) << 16;
+
+	//On failure error receives the line number and what was wrong with it, scene is left partially filled
+	bool Load(const char* path, SceneDescription& scene, std::string* error = nullptr);
+	bool Parse(const std::string& text, SceneDescription& scene, std::string* error = nullptr);
+}
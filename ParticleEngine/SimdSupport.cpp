@@ -0,0 +1,74 @@
+#include "SimdSupport.h"
+
+#if PARTICLE_ENGINE_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	bool DetectAvx2()
+	{
+#if PARTICLE_ENGINE_X86 && defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+		{
+			return false;
+		}
+
+		//The OS has to save the YMM registers, checked through OSXSAVE and XCR0
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+		{
+			return false;
+		}
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#elif PARTICLE_ENGINE_X86
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") != 0;
+#else
+		return false;
+#endif
+	}
+
+	SimdSupport::InstructionSet& Active()
+	{
+		static SimdSupport::InstructionSet active = SimdSupport::Detect();
+		return active;
+	}
+}
+
+SimdSupport::InstructionSet SimdSupport::Detect()
+{
+	static const InstructionSet detected = DetectAvx2() ? InstructionSet::AVX2 : (PARTICLE_ENGINE_X86 ? InstructionSet::SSE2 : InstructionSet::Scalar);
+	return detected;
+}
+
+SimdSupport::InstructionSet SimdSupport::GetActive()
+{
+	return Active();
+}
+
+void SimdSupport::SetActive(InstructionSet set)
+{
+	//Never select more than the machine can run
+	Active() = set > Detect() ? Detect() : set;
+}
+
+const char* SimdSupport::GetName(InstructionSet set)
+{
+	switch (set)
+	{
+	case InstructionSet::AVX2:
+		return "AVX2";
+	case InstructionSet::SSE2:
+		return "SSE2";
+	default:
+		return "Scalar";
+	}
+}
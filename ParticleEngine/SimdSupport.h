@@ -0,0 +1,34 @@
+#pragma once
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PARTICLE_ENGINE_X86 1
+#else
+#define PARTICLE_ENGINE_X86 0
+#endif
+
+//Marks functions that use AVX2 intrinsics, MSVC allows them in any function
+#if defined(_MSC_VER)
+#define PARTICLE_ENGINE_TARGET_AVX2
+#else
+#define PARTICLE_ENGINE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+//Runtime selection of the widest vector instruction set the CPU and OS support.
+//SSE2 is the baseline on x86, AVX2 is only used when detected.
+namespace SimdSupport
+{
+	enum class InstructionSet
+	{
+		Scalar,
+		SSE2,
+		AVX2
+	};
+
+	InstructionSet Detect();
+
+	//The set the kernels dispatch to, defaults to Detect() and can be lowered for testing
+	InstructionSet GetActive();
+	void SetActive(InstructionSet set);
+
+	const char* GetName(InstructionSet set);
+}
@@ -0,0 +1,189 @@
+#include "Snapshot.h"
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	uint64_t AlignUp(uint64_t offset)
+	{
+		return (offset + Snapshot::alignment - 1u) / Snapshot::alignment * Snapshot::alignment;
+	}
+
+	bool WriteZeros(FILE* file, size_t count)
+	{
+		const uint8_t zeros[Snapshot::alignment] = {};
+		return std::fwrite(zeros, 1u, count, file) == count;
+	}
+}
+
+Snapshot::Writer::Writer()
+{
+	std::memset(&header, 0, sizeof(header));
+	std::memset(m_slices, 0, sizeof(m_slices));
+}
+
+void Snapshot::Writer::SetArray(ArrayId id, size_t elementSize, const void* data, size_t count, const void* tail, size_t tailCount)
+{
+	const size_t index = static_cast<size_t>(id);
+
+	header.arrays[index].elementSize = static_cast<uint32_t>(elementSize);
+	header.arrays[index].count = count + tailCount;
+	m_slices[index].data[0] = data;
+	m_slices[index].count[0] = count;
+	m_slices[index].data[1] = tail;
+	m_slices[index].count[1] = tailCount;
+}
+
+bool Snapshot::Writer::Write(const char* path)
+{
+	header.magic = magic;
+	header.version = version;
+	header.headerSize = sizeof(Header);
+	header.arrayCount = static_cast<uint32_t>(arrayCount);
+
+	uint64_t offset = AlignUp(sizeof(Header));
+	for (size_t i = 0u; i < arrayCount; ++i)
+	{
+		header.arrays[i].id = static_cast<uint32_t>(i);
+		header.arrays[i].offset = offset;
+		offset = AlignUp(offset + header.arrays[i].count * header.arrays[i].elementSize);
+	}
+	header.fileSize = offset;
+
+	FILE* file = std::fopen(path, "wb");
+	if (!file)
+	{
+		return false;
+	}
+
+	bool written = std::fwrite(&header, sizeof(Header), 1u, file) == 1u;
+	uint64_t position = sizeof(Header);
+
+	for (size_t i = 0u; i < arrayCount && written; ++i)
+	{
+		written = WriteZeros(file, static_cast<size_t>(header.arrays[i].offset - position));
+		position = header.arrays[i].offset;
+
+		for (size_t s = 0u; s < 2u && written; ++s)
+		{
+			const size_t size = m_slices[i].count[s] * header.arrays[i].elementSize;
+			written = size == 0u || std::fwrite(m_slices[i].data[s], 1u, size, file) == size;
+			position += size;
+		}
+	}
+	written = written && WriteZeros(file, static_cast<size_t>(header.fileSize - position));
+
+	return std::fclose(file) == 0 && written;
+}
+
+Snapshot::Reader::Reader()
+	: m_data(nullptr)
+	, m_size(0u)
+{
+}
+
+Snapshot::Reader::~Reader()
+{
+	Close();
+}
+
+bool Snapshot::Reader::Open(const char* path)
+{
+	Close();
+
+	//The file and mapping handles can go right away, the view keeps the mapping alive
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(file, &size) && size.QuadPart >= static_cast<LONGLONG>(sizeof(Header)))
+	{
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0u, 0u, nullptr);
+		if (mapping != nullptr)
+		{
+			m_data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0u, 0u, 0u));
+			m_size = static_cast<size_t>(size.QuadPart);
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+#else
+	const int file = open(path, O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+
+	struct stat status;
+	if (fstat(file, &status) == 0 && status.st_size >= static_cast<off_t>(sizeof(Header)))
+	{
+		void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		if (data != MAP_FAILED)
+		{
+			m_data = static_cast<const uint8_t*>(data);
+			m_size = static_cast<size_t>(status.st_size);
+		}
+	}
+	close(file);
+#endif
+
+	if (m_data == nullptr)
+	{
+		m_size = 0u;
+		return false;
+	}
+
+	const Header& header = GetHeader();
+	bool valid = header.magic == magic
+		&& header.version == version
+		&& header.headerSize == sizeof(Header)
+		&& header.arrayCount == arrayCount
+		&& header.fileSize == m_size;
+
+	for (size_t i = 0u; i < arrayCount && valid; ++i)
+	{
+		const ArrayInfo& info = header.arrays[i];
+		valid = info.id == i
+			&& info.offset % alignment == 0u
+			&& info.offset <= m_size
+			&& (info.elementSize == 0u || info.count <= (m_size - info.offset) / info.elementSize);
+	}
+
+	if (!valid)
+	{
+		Close();
+	}
+	return valid;
+}
+
+void Snapshot::Reader::Close()
+{
+	if (m_data == nullptr)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+#else
+	munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+	m_data = nullptr;
+	m_size = 0u;
+}
@@ -0,0 +1,149 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cstddef>
+
+//Binary image of the dynamic simulation state, written and adopted by ParticleEngine::SaveSnapshot and LoadSnapshot.
+//A file is a fixed size header, whose array table describes every array, followed by the arrays themselves,
+//each starting at a multiple of alignment. Arrays hold their elements exactly as they sit in memory,
+//so a mapped file is taken over with one memcpy per array instead of being parsed element by element.
+//Files are native endian, one written on a machine with another byte order or element sizes fails the header checks.
+namespace Snapshot
+{
+	const static uint32_t magic = 0x50534E50u; //"PNSP" read as little endian
+	const static uint32_t version = 2u;
+	const static size_t alignment = 64u;
+
+	enum class ArrayId : uint32_t
+	{
+		ParticlePositions,
+		ParticleOldPositions,
+		ParticleVelocities,
+		ParticleAccelerations,
+		ParticleFlags,
+		Balls,
+		ClothNodes,
+		ClothConstraints,
+		Blizzards,
+		BlizzardSpawnPoints,
+		BallGenerators,
+		BallContacts,
+		Count
+	};
+
+	const static size_t arrayCount = static_cast<size_t>(ArrayId::Count);
+
+	struct ArrayInfo
+	{
+		uint32_t id;
+		uint32_t elementSize;
+		uint64_t count;
+		uint64_t offset; //From the start of the file
+	};
+
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t headerSize;
+		uint32_t arrayCount;
+		uint64_t fileSize;
+
+		uint64_t randomSeed;
+		uint64_t clothColumns;
+		uint64_t clothIterations;
+		uint64_t sleepingParticles;
+		uint64_t sleepingBalls;
+		float clothCompliance;
+		float accumulator;
+		uint32_t capacityMode;
+		uint32_t reserved;
+
+		ArrayInfo arrays[Snapshot::arrayCount];
+	};
+
+	//Balls and cloth nodes without the vtable of Particle
+	struct BodyRecord
+	{
+		glm::vec2 oldPosition;
+		glm::vec2 position;
+		glm::vec2 velocity;
+		glm::vec2 acceleration;
+		float mass;
+		float inverseMass;
+		float bounciness;
+		float staticFriction;
+		float kinematicFriction;
+		float radius;
+		uint32_t sleeping;
+		uint32_t restSteps;
+	};
+
+	//The spawn points of all blizzards are stored back to back in BlizzardSpawnPoints
+	struct BlizzardRecord
+	{
+		float spawnTime;
+		uint32_t spawnPointCount;
+	};
+
+	struct BallGeneratorRecord
+	{
+		float spawnTime;
+		uint32_t reserved;
+		uint64_t randomCounter;
+	};
+
+	//Lays the arrays out behind the header and writes the whole file
+	class Writer
+	{
+	public:
+		Writer();
+
+		//An array may come in two slices that are stored back to back, a wrapped ring buffer is written oldest first this way
+		void SetArray(ArrayId id, size_t elementSize, const void* data, size_t count, const void* tail = nullptr, size_t tailCount = 0u);
+
+		//Fills in the layout fields of header and writes it followed by the arrays
+		bool Write(const char* path);
+
+		Header header;
+
+	private:
+		struct Slices
+		{
+			const void* data[2];
+			size_t count[2];
+		};
+
+		Slices m_slices[arrayCount];
+	};
+
+	//Read only memory mapping of a snapshot file
+	class Reader
+	{
+	public:
+		Reader();
+		~Reader();
+
+		//Maps the file and checks the header and that every array lies inside the file
+		bool Open(const char* path);
+		void Close();
+
+		const Header& GetHeader() const { return *reinterpret_cast<const Header*>(m_data); }
+		size_t GetCount(ArrayId id) const { return static_cast<size_t>(GetHeader().arrays[static_cast<size_t>(id)].count); }
+
+		//nullptr if the file stores the array with another element size
+		template<typename T>
+		const T* GetArray(ArrayId id) const
+		{
+			const ArrayInfo& info = GetHeader().arrays[static_cast<size_t>(id)];
+			return info.elementSize == sizeof(T) ? reinterpret_cast<const T*>(m_data + info.offset) : nullptr;
+		}
+
+	private:
+		Reader(const Reader& other);
+		Reader& operator=(const Reader& other);
+
+		const uint8_t* m_data;
+		size_t m_size;
+	};
+}
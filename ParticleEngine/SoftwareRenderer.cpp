@@ -0,0 +1,452 @@
+#include "SoftwareRenderer.h"
+#include "ImageWriter.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	//Packs the channels in memory order, independent of the machines byte order
+	uint32_t MakeColor(uint8_t r, uint8_t g, uint8_t b)
+	{
+		const uint8_t bytes[4] = { r, g, b, 255u };
+		uint32_t color;
+		std::memcpy(&color, bytes, sizeof(color));
+		return color;
+	}
+
+	const uint32_t black = MakeColor(0u, 0u, 0u);
+	const uint32_t white = MakeColor(255u, 255u, 255u);
+	const uint32_t red = MakeColor(255u, 0u, 0u);
+	const uint32_t green = MakeColor(0u, 255u, 0u);
+	const uint32_t blue = MakeColor(0u, 0u, 255u);
+	const uint32_t yellow = MakeColor(255u, 255u, 0u);
+	const uint32_t cyan = MakeColor(0u, 255u, 255u);
+
+	glm::vec2 Interpolate(const glm::vec2& oldPosition, const glm::vec2& position, float alpha)
+	{
+		return oldPosition + (position - oldPosition) * alpha;
+	}
+
+	int PixelCoordinate(float value)
+	{
+		return static_cast<int>(std::floor(value));
+	}
+
+	//Liang-Barsky clip of the segment against [min, max], false if nothing is left
+	bool ClipLine(glm::vec2& start, glm::vec2& end, const glm::vec2& min, const glm::vec2& max)
+	{
+		const glm::vec2 delta = end - start;
+		const float p[4] = { -delta.x, delta.x, -delta.y, delta.y };
+		const float q[4] = { start.x - min.x, max.x - start.x, start.y - min.y, max.y - start.y };
+
+		float t0 = 0.0f;
+		float t1 = 1.0f;
+		for (int i = 0; i < 4; ++i)
+		{
+			if (p[i] == 0.0f)
+			{
+				if (q[i] < 0.0f)
+				{
+					return false;
+				}
+				continue;
+			}
+
+			const float t = q[i] / p[i];
+			if (p[i] < 0.0f)
+			{
+				t0 = std::max(t0, t);
+			}
+			else
+			{
+				t1 = std::min(t1, t);
+			}
+		}
+
+		if (t0 > t1)
+		{
+			return false;
+		}
+
+		end = start + delta * t1;
+		start = start + delta * t0;
+		return true;
+	}
+}
+
+SoftwareRenderer::SoftwareRenderer(size_t width, size_t height, size_t tileSize, size_t workerCount)
+	: m_width(std::max<size_t>(width, 1u))
+	, m_height(std::max<size_t>(height, 1u))
+	, m_tileSize(std::max<size_t>(tileSize, 1u))
+	, m_jobs(workerCount)
+{
+	m_tileColumns = (m_width + m_tileSize - 1u) / m_tileSize;
+	m_tileRows = (m_height + m_tileSize - 1u) / m_tileSize;
+	m_pixels.assign(m_width * m_height, black);
+	m_tileShapes.resize(m_tileColumns * m_tileRows);
+}
+
+void SoftwareRenderer::Render(const ParticleEngine& engine, float alpha)
+{
+	Profiler::ScopedTimer timer("SoftwareRender");
+
+	{
+		Profiler::ScopedTimer binTimer("Bin");
+		BuildShapes(engine, alpha);
+		BinShapes();
+		BinParticles(engine.GetParticles(), alpha);
+	}
+
+	m_jobs.ParallelFor(m_tileShapes.size(), 1u, [&](size_t begin, size_t end, size_t)
+	{
+		for (size_t tile = begin; tile < end; ++tile)
+		{
+			RenderTile(tile);
+		}
+	});
+}
+
+bool SoftwareRenderer::WritePng(const char* path) const
+{
+	return ImageWriter::WritePng(path, GetPixels(), m_width, m_height);
+}
+
+bool SoftwareRenderer::WriteRaw(FILE* file) const
+{
+	return ImageWriter::WriteRaw(file, GetPixels(), m_width, m_height);
+}
+
+//Same layers and colors as ParticleRenderer, in drawing order
+void SoftwareRenderer::BuildShapes(const ParticleEngine& engine, float alpha)
+{
+	m_shapes.clear();
+
+	const std::vector<Solid>& solids = engine.GetSolids();
+	for (size_t i = 0u; i < solids.size(); ++i)
+	{
+		AddBox(solids[i], red);
+	}
+
+	const std::vector<Blizzard>& blizzards = engine.GetBlizzards();
+	for (size_t i = 0u; i < blizzards.size(); ++i)
+	{
+		const std::vector<glm::vec2>& spawnPoints = blizzards[i].GetSpawnPoints();
+		for (size_t j = 0u; j < spawnPoints.size(); ++j)
+		{
+			AddDot(spawnPoints[j], red);
+		}
+	}
+
+	const std::vector<Fan>& fans = engine.GetFans();
+	for (size_t i = 0u; i < fans.size(); ++i)
+	{
+		AddArrow(fans[i].GetStart(), fans[i].GetEnd(), fans[i].GetBlowDirection(), fans[i].GetStrength(), green);
+	}
+
+	const std::vector<BallGenerator>& generators = engine.GetBallGenerators();
+	for (size_t i = 0u; i < generators.size(); ++i)
+	{
+		AddArrow(generators[i].GetStart(), generators[i].GetEnd(), generators[i].GetSpawnDirection(), generators[i].GetSpawnVelocity(), cyan);
+	}
+
+	//Cloth, the pinned top row is not drawn
+	const std::vector<Ball>& cloth = engine.GetCloth();
+	for (size_t i = engine.GetClothColumns(); i < cloth.size(); ++i)
+	{
+		AddRing(Interpolate(cloth[i].oldPosition, cloth[i].position, alpha), cloth[i].radius, yellow);
+	}
+
+	const std::vector<ClothSolver::Constraint>& constraints = engine.GetClothConstraints();
+	for (size_t i = 0u; i < constraints.size(); ++i)
+	{
+		const Ball& a = cloth[constraints[i].a];
+		const Ball& b = cloth[constraints[i].b];
+		AddLine(Interpolate(a.oldPosition, a.position, alpha), Interpolate(b.oldPosition, b.position, alpha), blue);
+	}
+
+	const std::vector<Ball>& balls = engine.GetBalls();
+	for (size_t i = 0u; i < balls.size(); ++i)
+	{
+		AddRing(Interpolate(balls[i].oldPosition, balls[i].position, alpha), balls[i].radius, yellow);
+	}
+}
+
+void SoftwareRenderer::AddBox(const Solid& solid, uint32_t color)
+{
+	Shape shape;
+	shape.type = Shape::Type::Box;
+	shape.color = color;
+	shape.a = solid.oobb.center;
+	shape.b = solid.oobb.halfSize;
+	shape.axes[0] = solid.oobb.u[0];
+	shape.axes[1] = solid.oobb.u[1];
+	m_shapes.push_back(shape);
+}
+
+void SoftwareRenderer::AddLine(const glm::vec2& start, const glm::vec2& end, uint32_t color)
+{
+	Shape shape;
+	shape.type = Shape::Type::Line;
+	shape.color = color;
+	shape.a = start;
+	shape.b = end;
+	m_shapes.push_back(shape);
+}
+
+void SoftwareRenderer::AddArrow(const glm::vec2& start, const glm::vec2& end, const glm::vec2& direction, float length, uint32_t color)
+{
+	const glm::vec2 center = (start + end) * 0.5f;
+
+	AddLine(start, end, color);
+	AddLine(center, center + direction * length, color);
+}
+
+void SoftwareRenderer::AddRing(const glm::vec2& center, float radius, uint32_t color)
+{
+	Shape shape;
+	shape.type = Shape::Type::Ring;
+	shape.color = color;
+	shape.a = center;
+	shape.b = glm::vec2(radius, 0.0f);
+	m_shapes.push_back(shape);
+}
+
+void SoftwareRenderer::AddDot(const glm::vec2& center, uint32_t color)
+{
+	Shape shape;
+	shape.type = Shape::Type::Dot;
+	shape.color = color;
+	shape.a = center;
+	shape.b = glm::vec2(0.0f);
+	m_shapes.push_back(shape);
+}
+
+void SoftwareRenderer::BinShapes()
+{
+	for (size_t t = 0u; t < m_tileShapes.size(); ++t)
+	{
+		m_tileShapes[t].clear();
+	}
+
+	for (size_t i = 0u; i < m_shapes.size(); ++i)
+	{
+		const Shape& shape = m_shapes[i];
+
+		glm::vec2 min;
+		glm::vec2 max;
+		switch (shape.type)
+		{
+		case Shape::Type::Box:
+		{
+			const glm::vec2 extent = glm::abs(shape.axes[0]) * shape.b.x + glm::abs(shape.axes[1]) * shape.b.y;
+			min = shape.a - extent;
+			max = shape.a + extent;
+			break;
+		}
+		case Shape::Type::Line:
+			min = glm::min(shape.a, shape.b);
+			max = glm::max(shape.a, shape.b);
+			break;
+		case Shape::Type::Ring:
+			min = shape.a - glm::vec2(shape.b.x + 1.0f);
+			max = shape.a + glm::vec2(shape.b.x + 1.0f);
+			break;
+		default:
+			min = shape.a;
+			max = shape.a;
+			break;
+		}
+
+		if (max.x < 0.0f || max.y < 0.0f)
+		{
+			continue;
+		}
+
+		const int tileSize = static_cast<int>(m_tileSize);
+		const int minX = std::max(PixelCoordinate(min.x), 0) / tileSize;
+		const int minY = std::max(PixelCoordinate(min.y), 0) / tileSize;
+		const int maxX = std::min(PixelCoordinate(max.x) / tileSize, static_cast<int>(m_tileColumns) - 1);
+		const int maxY = std::min(PixelCoordinate(max.y) / tileSize, static_cast<int>(m_tileRows) - 1);
+
+		for (int y = minY; y <= maxY; ++y)
+		{
+			for (int x = minX; x <= maxX; ++x)
+			{
+				m_tileShapes[y * m_tileColumns + x].push_back(static_cast<uint32_t>(i));
+			}
+		}
+	}
+}
+
+//Two passes over fixed particle chunks, first counting per chunk and tile, then scattering.
+//The prefix sum over (tile, chunk) keeps every tile's particles in store order.
+void SoftwareRenderer::BinParticles(const ParticleStore& particles, float alpha)
+{
+	const size_t count = particles.Size();
+	const size_t tileCount = m_tileShapes.size();
+	const size_t chunkCount = (count + particleChunkSize - 1u) / particleChunkSize;
+
+	m_particlePixel.resize(count);
+	m_particleTile.resize(count);
+	m_chunkTileCounts.assign(chunkCount * tileCount, 0u);
+
+	const glm::vec2* position = particles.Positions();
+	const glm::vec2* oldPosition = particles.OldPositions();
+
+	m_jobs.ParallelFor(count, particleChunkSize, [&](size_t begin, size_t end, size_t)
+	{
+		uint32_t* counts = &m_chunkTileCounts[(begin / particleChunkSize) * tileCount];
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			const glm::vec2 p = Interpolate(oldPosition[i], position[i], alpha);
+			const int x = PixelCoordinate(p.x);
+			const int y = PixelCoordinate(p.y);
+
+			if (x < 0 || y < 0 || x >= static_cast<int>(m_width) || y >= static_cast<int>(m_height))
+			{
+				m_particlePixel[i] = noPixel;
+				continue;
+			}
+
+			const uint32_t tile = static_cast<uint32_t>((y / m_tileSize) * m_tileColumns + x / m_tileSize);
+			m_particlePixel[i] = static_cast<uint32_t>(y * m_width + x);
+			m_particleTile[i] = tile;
+			++counts[tile];
+		}
+	});
+
+	//Turn the counts into write offsets, tile major so each tile ends up contiguous
+	m_tileParticleStart.assign(tileCount + 1u, 0u);
+	uint32_t offset = 0u;
+	for (size_t t = 0u; t < tileCount; ++t)
+	{
+		m_tileParticleStart[t] = offset;
+		for (size_t c = 0u; c < chunkCount; ++c)
+		{
+			const uint32_t chunkTileCount = m_chunkTileCounts[c * tileCount + t];
+			m_chunkTileCounts[c * tileCount + t] = offset;
+			offset += chunkTileCount;
+		}
+	}
+	m_tileParticleStart[tileCount] = offset;
+	m_tileParticles.resize(offset);
+
+	m_jobs.ParallelFor(count, particleChunkSize, [&](size_t begin, size_t end, size_t)
+	{
+		uint32_t* cursor = &m_chunkTileCounts[(begin / particleChunkSize) * tileCount];
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			if (m_particlePixel[i] != noPixel)
+			{
+				m_tileParticles[cursor[m_particleTile[i]]++] = m_particlePixel[i];
+			}
+		}
+	});
+}
+
+void SoftwareRenderer::RenderTile(size_t tile)
+{
+	const int minX = static_cast<int>((tile % m_tileColumns) * m_tileSize);
+	const int minY = static_cast<int>((tile / m_tileColumns) * m_tileSize);
+	const int maxX = std::min(minX + static_cast<int>(m_tileSize), static_cast<int>(m_width)) - 1;
+	const int maxY = std::min(minY + static_cast<int>(m_tileSize), static_cast<int>(m_height)) - 1;
+
+	for (int y = minY; y <= maxY; ++y)
+	{
+		std::fill(&m_pixels[y * m_width + minX], &m_pixels[y * m_width + maxX] + 1, black);
+	}
+
+	const std::vector<uint32_t>& shapes = m_tileShapes[tile];
+	for (size_t i = 0u; i < shapes.size(); ++i)
+	{
+		DrawShape(m_shapes[shapes[i]], minX, minY, maxX, maxY);
+	}
+
+	for (uint32_t i = m_tileParticleStart[tile]; i < m_tileParticleStart[tile + 1u]; ++i)
+	{
+		m_pixels[m_tileParticles[i]] = white;
+	}
+}
+
+//Draws the part of the shape inside the pixel rectangle [minX, maxX] x [minY, maxY], sampling at pixel centers
+void SoftwareRenderer::DrawShape(const Shape& shape, int minX, int minY, int maxX, int maxY)
+{
+	switch (shape.type)
+	{
+	case Shape::Type::Box:
+	{
+		for (int y = minY; y <= maxY; ++y)
+		{
+			for (int x = minX; x <= maxX; ++x)
+			{
+				const glm::vec2 relative = glm::vec2(x + 0.5f, y + 0.5f) - shape.a;
+				if (std::abs(glm::dot(relative, shape.axes[0])) <= shape.b.x && std::abs(glm::dot(relative, shape.axes[1])) <= shape.b.y)
+				{
+					m_pixels[y * m_width + x] = shape.color;
+				}
+			}
+		}
+		break;
+	}
+	case Shape::Type::Line:
+	{
+		glm::vec2 start = shape.a;
+		glm::vec2 end = shape.b;
+		if (!ClipLine(start, end, glm::vec2(static_cast<float>(minX), static_cast<float>(minY)), glm::vec2(maxX + 1.0f, maxY + 1.0f)))
+		{
+			break;
+		}
+
+		//One sample per pixel along the major axis
+		const glm::vec2 delta = end - start;
+		const int steps = std::max(1, static_cast<int>(std::ceil(std::max(std::abs(delta.x), std::abs(delta.y)))));
+		for (int s = 0; s <= steps; ++s)
+		{
+			const glm::vec2 p = start + delta * (static_cast<float>(s) / static_cast<float>(steps));
+			const int x = std::min(std::max(PixelCoordinate(p.x), minX), maxX);
+			const int y = std::min(std::max(PixelCoordinate(p.y), minY), maxY);
+			m_pixels[y * m_width + x] = shape.color;
+		}
+		break;
+	}
+	case Shape::Type::Ring:
+	{
+		const float radius = shape.b.x;
+		const int ringMinX = std::max(PixelCoordinate(shape.a.x - radius - 1.0f), minX);
+		const int ringMinY = std::max(PixelCoordinate(shape.a.y - radius - 1.0f), minY);
+		const int ringMaxX = std::min(PixelCoordinate(shape.a.x + radius + 1.0f), maxX);
+		const int ringMaxY = std::min(PixelCoordinate(shape.a.y + radius + 1.0f), maxY);
+
+		//One pixel wide outline, compared squared against the inner and outer edge
+		const float inner = std::max(radius - 0.5f, 0.0f) * std::max(radius - 0.5f, 0.0f);
+		const float outer = (radius + 0.5f) * (radius + 0.5f);
+		for (int y = ringMinY; y <= ringMaxY; ++y)
+		{
+			for (int x = ringMinX; x <= ringMaxX; ++x)
+			{
+				const glm::vec2 relative = glm::vec2(x + 0.5f, y + 0.5f) - shape.a;
+				const float distanceSquared = glm::dot(relative, relative);
+				if (distanceSquared >= inner && distanceSquared <= outer)
+				{
+					m_pixels[y * m_width + x] = shape.color;
+				}
+			}
+		}
+		break;
+	}
+	case Shape::Type::Dot:
+	{
+		const int x = PixelCoordinate(shape.a.x);
+		const int y = PixelCoordinate(shape.a.y);
+		if (x >= minX && x <= maxX && y >= minY && y <= maxY)
+		{
+			m_pixels[y * m_width + x] = shape.color;
+		}
+		break;
+	}
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include "ParticleEngine.h"
+#include "JobSystem.h"
+
+//CPU rasterizer for machines without a GPU, draws the same scene as ParticleRenderer into an RGBA buffer.
+//The framebuffer is split into square tiles. Every shape and particle is binned into the tiles it touches,
+//then the tiles are rendered in parallel, each by exactly one worker, so no pixel is ever shared.
+class SoftwareRenderer
+{
+public:
+	//workerCount includes the calling thread, 0 uses every hardware thread
+	SoftwareRenderer(size_t width, size_t height, size_t tileSize = Config::renderTileSize, size_t workerCount = Config::workerCount);
+
+	//alpha blends every body between its previous and current step, see ParticleEngine::Advance
+	void Render(const ParticleEngine& engine, float alpha = 1.0f);
+
+	//8 bit RGBA, rows from top to bottom
+	const uint8_t* GetPixels() const { return reinterpret_cast<const uint8_t*>(&m_pixels[0]); }
+	size_t GetWidth() const { return m_width; }
+	size_t GetHeight() const { return m_height; }
+
+	bool WritePng(const char* path) const;
+	bool WriteRaw(FILE* file) const;
+
+private:
+	const static size_t particleChunkSize = 16384u;
+	const static uint32_t noPixel = 0xFFFFFFFFu;
+
+	struct Shape
+	{
+		enum class Type
+		{
+			Box,
+			Line,
+			Ring,
+			Dot
+		};
+
+		Type type;
+		uint32_t color;
+		glm::vec2 a; //Box center, line start, ring or dot center
+		glm::vec2 b; //Box half size, line end, ring radius in x
+		glm::vec2 axes[2]; //Box only
+	};
+
+	SoftwareRenderer(const SoftwareRenderer& other);
+	SoftwareRenderer& operator=(const SoftwareRenderer& other);
+
+	void BuildShapes(const ParticleEngine& engine, float alpha);
+	void AddBox(const Solid& solid, uint32_t color);
+	void AddLine(const glm::vec2& start, const glm::vec2& end, uint32_t color);
+	void AddArrow(const glm::vec2& start, const glm::vec2& end, const glm::vec2& direction, float length, uint32_t color);
+	void AddRing(const glm::vec2& center, float radius, uint32_t color);
+	void AddDot(const glm::vec2& center, uint32_t color);
+	void BinShapes();
+	void BinParticles(const ParticleStore& particles, float alpha);
+	void RenderTile(size_t tile);
+	void DrawShape(const Shape& shape, int minX, int minY, int maxX, int maxY);
+
+	size_t m_width;
+	size_t m_height;
+	size_t m_tileSize;
+	size_t m_tileColumns;
+	size_t m_tileRows;
+	std::vector<uint32_t> m_pixels;
+
+	std::vector<Shape> m_shapes;
+	std::vector<std::vector<uint32_t>> m_tileShapes;
+
+	//Particles counting sorted by tile, m_tileParticleStart[t] to m_tileParticleStart[t + 1] are the pixels of tile t
+	std::vector<uint32_t> m_particlePixel;
+	std::vector<uint32_t> m_particleTile;
+	std::vector<uint32_t> m_chunkTileCounts;
+	std::vector<uint32_t> m_tileParticleStart;
+	std::vector<uint32_t> m_tileParticles;
+
+	JobSystem m_jobs;
+};
@@ -1,22 +1,27 @@
 ﻿#pragma once
-#include "sfml/Graphics.hpp"
+#include <glm/glm.hpp>
 #include "Collision.hpp"
 
+//Static box, positioned by its center and rotated around it
 struct Solid
 {
 	Solid();
 
-	void Render(sf::RenderWindow& window);
-	void SetPosition(const sf::Vector2f& newPos);
-	void SetSize(const sf::Vector2f& newSize);
+	void SetPosition(const glm::vec2& newPos);
+	void SetSize(const glm::vec2& newSize);
 	void SetRotation(const float newRotation);
 
-	sf::RectangleShape shape;
+	const glm::vec2& GetPosition() const { return position; }
+	const glm::vec2& GetSize() const { return size; }
+	float GetRotation() const { return rotation; }
 
 	Collisions::BoundingVolumes::AABB aabb;
 	Collisions::BoundingVolumes::OOBB oobb;
 
 private:
 	void UpdateBoundingVolumes();
-	void RenderOOBB(sf::RenderWindow& window);
+
+	glm::vec2 position;
+	glm::vec2 size;
+	float rotation; //Degrees
 };
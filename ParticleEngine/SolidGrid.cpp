@@ -0,0 +1,90 @@
+#include "SolidGrid.h"
+
+SolidGrid::SolidGrid()
+	: m_origin(0.0f)
+	, m_cellSize(1.0f)
+	, m_inverseCellSize(1.0f)
+	, m_columns(0)
+	, m_rows(0)
+{
+}
+
+void SolidGrid::Build(const std::vector<Solid>& solids)
+{
+	m_cellStart.clear();
+	m_cellSolids.clear();
+	m_solidMinCell.clear();
+	m_columns = 0;
+	m_rows = 0;
+
+	if (solids.empty())
+	{
+		return;
+	}
+
+	//Bounds of all static geometry
+	glm::vec2 min = solids[0].aabb.min;
+	glm::vec2 max = solids[0].aabb.max;
+	for (size_t i = 1u; i < solids.size(); ++i)
+	{
+		min = glm::min(min, solids[i].aabb.min);
+		max = glm::max(max, solids[i].aabb.max);
+	}
+	glm::vec2 extent = max - min;
+
+	//Aim for a few cells per solid so that each cell only lists its local neighbourhood
+	float cellSize = std::sqrt((extent.x * extent.y) / (4.0f * static_cast<float>(solids.size())));
+	cellSize = std::max(cellSize, std::max(extent.x, extent.y) / static_cast<float>(maxCellsPerAxis));
+	cellSize = std::max(cellSize, 1.0f);
+
+	m_origin = min;
+	m_cellSize = cellSize;
+	m_inverseCellSize = 1.0f / cellSize;
+	m_columns = std::min(CellCoordinate(extent.x) + 1, maxCellsPerAxis);
+	m_rows = std::min(CellCoordinate(extent.y) + 1, maxCellsPerAxis);
+
+	//Two passes over the cell ranges of every solid, first counting then filling
+	const size_t cellCount = static_cast<size_t>(m_columns * m_rows);
+	m_cellStart.assign(cellCount + 1u, 0u);
+	m_solidMinCell.resize(solids.size());
+
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		std::vector<uint32_t> cursor;
+		if (pass == 1)
+		{
+			for (size_t i = 0u; i < cellCount; ++i)
+			{
+				m_cellStart[i + 1u] += m_cellStart[i];
+			}
+			cursor.assign(m_cellStart.begin(), m_cellStart.end() - 1);
+			m_cellSolids.resize(m_cellStart[cellCount]);
+		}
+
+		for (size_t s = 0u; s < solids.size(); ++s)
+		{
+			const int minX = std::max(CellCoordinate(solids[s].aabb.min.x - m_origin.x), 0);
+			const int minY = std::max(CellCoordinate(solids[s].aabb.min.y - m_origin.y), 0);
+			const int maxX = std::min(CellCoordinate(solids[s].aabb.max.x - m_origin.x), m_columns - 1);
+			const int maxY = std::min(CellCoordinate(solids[s].aabb.max.y - m_origin.y), m_rows - 1);
+
+			m_solidMinCell[s] = glm::ivec2(minX, minY);
+
+			for (int y = minY; y <= maxY; ++y)
+			{
+				for (int x = minX; x <= maxX; ++x)
+				{
+					const size_t cell = y * m_columns + x;
+					if (pass == 0)
+					{
+						++m_cellStart[cell + 1u];
+					}
+					else
+					{
+						m_cellSolids[cursor[cell]++] = static_cast<uint32_t>(s);
+					}
+				}
+			}
+		}
+	}
+}
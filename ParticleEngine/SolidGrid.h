@@ -0,0 +1,92 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include "Solid.h"
+
+//Uniform grid mapping every cell to the solids whose AABB overlaps it.
+//Solids are static, so the grid is built once with the scene and only read afterwards.
+class SolidGrid
+{
+public:
+	SolidGrid();
+
+	void Build(const std::vector<Solid>& solids);
+
+	//Calls visitor(solidIndex) for every solid whose cell list contains point
+	template<typename Visitor>
+	void QueryPoint(const glm::vec2& point, Visitor visitor) const
+	{
+		int x, y;
+		if (!CellOf(point, x, y))
+		{
+			return;
+		}
+
+		const size_t cell = y * m_columns + x;
+		for (uint32_t i = m_cellStart[cell]; i < m_cellStart[cell + 1]; ++i)
+		{
+			visitor(m_cellSolids[i]);
+		}
+	}
+
+	//Calls visitor(solidIndex) once for every solid sharing a cell with the box
+	template<typename Visitor>
+	void QueryBox(const glm::vec2& min, const glm::vec2& max, Visitor visitor) const
+	{
+		if (m_cellStart.empty())
+		{
+			return;
+		}
+
+		const int minX = std::max(CellCoordinate(min.x - m_origin.x), 0);
+		const int minY = std::max(CellCoordinate(min.y - m_origin.y), 0);
+		const int maxX = std::min(CellCoordinate(max.x - m_origin.x), m_columns - 1);
+		const int maxY = std::min(CellCoordinate(max.y - m_origin.y), m_rows - 1);
+
+		for (int y = minY; y <= maxY; ++y)
+		{
+			for (int x = minX; x <= maxX; ++x)
+			{
+				const size_t cell = y * m_columns + x;
+				for (uint32_t i = m_cellStart[cell]; i < m_cellStart[cell + 1]; ++i)
+				{
+					//A solid spanning several cells is only reported from the first cell both ranges share
+					const uint32_t solid = m_cellSolids[i];
+					if (x == std::max(m_solidMinCell[solid].x, minX) && y == std::max(m_solidMinCell[solid].y, minY))
+					{
+						visitor(solid);
+					}
+				}
+			}
+		}
+	}
+
+private:
+	const static int maxCellsPerAxis = 256;
+
+	int CellCoordinate(float value) const
+	{
+		return static_cast<int>(std::floor(value * m_inverseCellSize));
+	}
+
+	bool CellOf(const glm::vec2& point, int& x, int& y) const
+	{
+		x = CellCoordinate(point.x - m_origin.x);
+		y = CellCoordinate(point.y - m_origin.y);
+
+		return x >= 0 && y >= 0 && x < m_columns && y < m_rows;
+	}
+
+	glm::vec2 m_origin;
+	float m_cellSize;
+	float m_inverseCellSize;
+	int m_columns;
+	int m_rows;
+
+	std::vector<uint32_t> m_cellStart;
+	std::vector<uint32_t> m_cellSolids;
+	std::vector<glm::ivec2> m_solidMinCell;
+};
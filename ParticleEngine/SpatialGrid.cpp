@@ -0,0 +1,61 @@
+#include "SpatialGrid.h"
+
+SpatialGrid::SpatialGrid()
+	: m_cellSize(1.0f)
+	, m_inverseCellSize(1.0f)
+	, m_bucketMask(0u)
+{
+}
+
+void SpatialGrid::Begin(float cellSize, size_t expectedCount)
+{
+	m_cellSize = cellSize;
+	m_inverseCellSize = 1.0f / cellSize;
+
+	//Twice as many buckets as bodies keeps the chains short
+	size_t bucketCount = 64u;
+	while (bucketCount < expectedCount * 2u)
+	{
+		bucketCount <<= 1;
+	}
+	m_bucketMask = bucketCount - 1u;
+
+	m_pending.clear();
+	m_pending.reserve(expectedCount);
+}
+
+void SpatialGrid::Insert(const glm::vec2& position, uint32_t id)
+{
+	Entry entry;
+	entry.id = id;
+	entry.cellX = CellCoordinate(position.x);
+	entry.cellY = CellCoordinate(position.y);
+	entry.bucket = static_cast<uint32_t>(Hash(entry.cellX, entry.cellY));
+
+	m_pending.push_back(entry);
+}
+
+//Counting sort of all pending entries by bucket
+void SpatialGrid::Build()
+{
+	const size_t bucketCount = m_bucketMask + 1u;
+
+	m_bucketStart.assign(bucketCount + 1u, 0u);
+	for (size_t i = 0u; i < m_pending.size(); ++i)
+	{
+		++m_bucketStart[m_pending[i].bucket + 1u];
+	}
+
+	for (size_t i = 0u; i < bucketCount; ++i)
+	{
+		m_bucketStart[i + 1u] += m_bucketStart[i];
+	}
+
+	m_bucketCursor.assign(m_bucketStart.begin(), m_bucketStart.end() - 1);
+	m_entries.resize(m_pending.size());
+
+	for (size_t i = 0u; i < m_pending.size(); ++i)
+	{
+		m_entries[m_bucketCursor[m_pending[i].bucket]++] = m_pending[i];
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+//Counts the narrow phase tests a broad phase let through and how many of them actually hit
+struct BroadphaseStats
+{
+	BroadphaseStats() : pairsTested(0u), pairsHit(0u) {}
+
+	void Reset() { pairsTested = 0u; pairsHit = 0u; }
+
+	size_t pairsTested;
+	size_t pairsHit;
+};
+
+//Spatial hash over dynamic bodies, rebuilt from scratch every frame.
+//The cell size has to be at least the largest interaction distance, then every
+//body that can touch a query position is found in the 3x3 cells around it.
+class SpatialGrid
+{
+public:
+	SpatialGrid();
+
+	void Begin(float cellSize, size_t expectedCount);
+	void Insert(const glm::vec2& position, uint32_t id);
+	void Build();
+
+	//Calls visitor(id) for every body inserted in the 3x3 cells around position
+	template<typename Visitor>
+	void Query(const glm::vec2& position, Visitor visitor) const
+	{
+		if (m_entries.empty())
+		{
+			return;
+		}
+
+		const int cellX = CellCoordinate(position.x);
+		const int cellY = CellCoordinate(position.y);
+
+		for (int y = cellY - 1; y <= cellY + 1; ++y)
+		{
+			for (int x = cellX - 1; x <= cellX + 1; ++x)
+			{
+				const size_t bucket = Hash(x, y);
+
+				for (uint32_t i = m_bucketStart[bucket]; i < m_bucketStart[bucket + 1]; ++i)
+				{
+					//Different cells can share a bucket, skip the ones that only collide in the hash
+					if (m_entries[i].cellX == x && m_entries[i].cellY == y)
+					{
+						visitor(m_entries[i].id);
+					}
+				}
+			}
+		}
+	}
+
+	float GetCellSize() const { return m_cellSize; }
+	size_t Size() const { return m_entries.size(); }
+
+private:
+	struct Entry
+	{
+		uint32_t id;
+		uint32_t bucket;
+		int cellX;
+		int cellY;
+	};
+
+	int CellCoordinate(float value) const
+	{
+		return static_cast<int>(std::floor(value * m_inverseCellSize));
+	}
+
+	size_t Hash(int x, int y) const
+	{
+		return ((static_cast<uint32_t>(x) * 73856093u) ^ (static_cast<uint32_t>(y) * 19349663u)) & m_bucketMask;
+	}
+
+	std::vector<Entry> m_pending;
+	std::vector<Entry> m_entries;
+	std::vector<uint32_t> m_bucketStart;
+	std::vector<uint32_t> m_bucketCursor;
+
+	float m_cellSize;
+	float m_inverseCellSize;
+	size_t m_bucketMask;
+};
@@ -0,0 +1,351 @@
+#include "TrajectoryRecorder.h"
+#include "ParticleEngine.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	//Keeps far away bodies from overflowing the quantized values
+	const float maxQuantized = 1073741824.0f;
+
+	uint64_t ZigZag(int64_t value)
+	{
+		return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+	}
+
+	int64_t UnZigZag(uint64_t value)
+	{
+		return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1u);
+	}
+}
+
+TrajectoryRecorder::TrajectoryRecorder(float quantization, size_t queueDepth, size_t keyframeInterval)
+	: m_quantization(quantization)
+	, m_keyframeInterval(std::max<size_t>(keyframeInterval, 1u))
+	, m_file(nullptr)
+	, m_running(false)
+	, m_framesWritten(0u)
+	, m_framesRecorded(0u)
+	, m_stalls(0u)
+	, m_rawBytes(0u)
+	, m_bytesWritten(0u)
+	, m_writeFailed(false)
+{
+	//One frame more than the queue holds, so the simulation can stage while the writer encodes
+	for (size_t i = 0u; i < std::max<size_t>(queueDepth, 1u) + 1u; ++i)
+	{
+		m_frames.push_back(std::unique_ptr<Frame>(new Frame()));
+	}
+}
+
+TrajectoryRecorder::~TrajectoryRecorder()
+{
+	Close();
+}
+
+bool TrajectoryRecorder::Open(const char* path)
+{
+	Close();
+
+	m_file = std::fopen(path, "wb");
+	if (!m_file)
+	{
+		return false;
+	}
+
+	Trajectory::FileHeader header;
+	header.magic = Trajectory::magic;
+	header.version = Trajectory::version;
+	header.quantization = m_quantization;
+	header.keyframeInterval = static_cast<uint32_t>(m_keyframeInterval);
+
+	m_writeFailed = std::fwrite(&header, sizeof(header), 1u, m_file) != 1u;
+	m_bytesWritten = sizeof(header);
+	m_framesWritten = 0u;
+	m_framesRecorded = 0u;
+	m_stalls = 0u;
+	m_rawBytes = 0u;
+	m_previous.clear();
+
+	m_free.clear();
+	m_pending.clear();
+	for (size_t i = 0u; i < m_frames.size(); ++i)
+	{
+		m_free.push_back(m_frames[i].get());
+	}
+
+	m_running = true;
+	m_writer = std::thread(&TrajectoryRecorder::WriterLoop, this);
+	return true;
+}
+
+void TrajectoryRecorder::Record(const ParticleEngine& engine)
+{
+	if (!m_file)
+	{
+		return;
+	}
+
+	Frame* frame;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_free.empty())
+		{
+			++m_stalls;
+			m_frameFreed.wait(lock, [this] { return !m_free.empty(); });
+		}
+		frame = m_free.front();
+		m_free.pop_front();
+	}
+
+	//Particles by slot, a slot keeps its particle until it is evicted or compacted, which keeps the deltas small
+	const ParticleStore& particles = engine.GetParticles();
+	const std::vector<Ball>& balls = engine.GetBalls();
+	const std::vector<Ball>& cloth = engine.GetCloth();
+
+	frame->particleCount = static_cast<uint32_t>(particles.Size());
+	frame->particleHead = static_cast<uint32_t>(particles.Head());
+	frame->ballCount = static_cast<uint32_t>(balls.size());
+	frame->clothCount = static_cast<uint32_t>(cloth.size());
+	frame->positions.resize(particles.Size() + balls.size() + cloth.size());
+
+	if (!particles.Empty())
+	{
+		std::memcpy(&frame->positions[0], particles.Positions(), particles.Size() * sizeof(glm::vec2));
+	}
+
+	glm::vec2* bodies = frame->positions.data() + particles.Size();
+	for (size_t i = 0u; i < balls.size(); ++i)
+	{
+		*bodies++ = balls[i].position;
+	}
+	for (size_t i = 0u; i < cloth.size(); ++i)
+	{
+		*bodies++ = cloth[i].position;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pending.push_back(frame);
+	}
+	m_framePending.notify_one();
+
+	++m_framesRecorded;
+	m_rawBytes += frame->positions.size() * sizeof(glm::vec2);
+}
+
+bool TrajectoryRecorder::Close()
+{
+	if (!m_file)
+	{
+		return true;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_running = false;
+	}
+	m_framePending.notify_one();
+	m_writer.join();
+
+	const bool closed = std::fclose(m_file) == 0;
+	m_file = nullptr;
+	return closed && !m_writeFailed;
+}
+
+void TrajectoryRecorder::WriterLoop()
+{
+	for (;;)
+	{
+		Frame* frame;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_framePending.wait(lock, [this] { return !m_pending.empty() || !m_running; });
+
+			//The queue is drained before the writer stops
+			if (m_pending.empty())
+			{
+				return;
+			}
+			frame = m_pending.front();
+			m_pending.pop_front();
+		}
+
+		const bool keyframe = m_framesWritten % m_keyframeInterval == 0u;
+		Encode(*frame, keyframe);
+
+		Trajectory::FrameHeader header;
+		header.payloadSize = static_cast<uint32_t>(m_encoded.size());
+		header.flags = keyframe ? Trajectory::FrameHeader::keyframe : 0u;
+		header.particleCount = frame->particleCount;
+		header.particleHead = frame->particleHead;
+		header.ballCount = frame->ballCount;
+		header.clothCount = frame->clothCount;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_free.push_back(frame);
+		}
+		m_frameFreed.notify_one();
+
+		const bool written = std::fwrite(&header, sizeof(header), 1u, m_file) == 1u
+			&& (m_encoded.empty() || std::fwrite(&m_encoded[0], 1u, m_encoded.size(), m_file) == m_encoded.size());
+		if (!written)
+		{
+			m_writeFailed = true;
+		}
+
+		m_bytesWritten += sizeof(header) + m_encoded.size();
+		++m_framesWritten;
+	}
+}
+
+void TrajectoryRecorder::Encode(const Frame& frame, bool keyframe)
+{
+	const size_t valueCount = frame.positions.size() * 2u;
+	const float* values = valueCount > 0u ? &frame.positions[0].x : nullptr;
+	const float scale = 1.0f / m_quantization;
+	const size_t referenceCount = keyframe ? 0u : m_previous.size();
+
+	m_encoded.clear();
+	m_current.resize(valueCount);
+
+	size_t zeroRun = 0u;
+	for (size_t i = 0u; i < valueCount; ++i)
+	{
+		const float scaled = std::min(std::max(values[i] * scale, -maxQuantized), maxQuantized);
+		const int32_t quantized = static_cast<int32_t>(std::lround(scaled));
+		const int64_t reference = i < referenceCount ? m_previous[i] : 0;
+		m_current[i] = quantized;
+
+		const uint64_t delta = ZigZag(static_cast<int64_t>(quantized) - reference);
+		if (delta == 0u)
+		{
+			++zeroRun;
+			continue;
+		}
+
+		if (zeroRun > 0u)
+		{
+			PutVarint(((zeroRun - 1u) << 1) | 1u);
+			zeroRun = 0u;
+		}
+		PutVarint(delta << 1);
+	}
+
+	if (zeroRun > 0u)
+	{
+		PutVarint(((zeroRun - 1u) << 1) | 1u);
+	}
+
+	m_previous.swap(m_current);
+}
+
+void TrajectoryRecorder::PutVarint(uint64_t value)
+{
+	while (value >= 0x80u)
+	{
+		m_encoded.push_back(static_cast<uint8_t>(value | 0x80u));
+		value >>= 7;
+	}
+	m_encoded.push_back(static_cast<uint8_t>(value));
+}
+
+TrajectoryReader::TrajectoryReader()
+	: m_file(nullptr)
+{
+	std::memset(&m_header, 0, sizeof(m_header));
+}
+
+TrajectoryReader::~TrajectoryReader()
+{
+	Close();
+}
+
+bool TrajectoryReader::Open(const char* path)
+{
+	Close();
+
+	m_file = std::fopen(path, "rb");
+	if (!m_file)
+	{
+		return false;
+	}
+
+	if (std::fread(&m_header, sizeof(m_header), 1u, m_file) != 1u
+		|| m_header.magic != Trajectory::magic
+		|| m_header.version != Trajectory::version
+		|| !(m_header.quantization > 0.0f))
+	{
+		Close();
+		return false;
+	}
+
+	m_previous.clear();
+	return true;
+}
+
+void TrajectoryReader::Close()
+{
+	if (m_file)
+	{
+		std::fclose(m_file);
+		m_file = nullptr;
+	}
+}
+
+bool TrajectoryReader::ReadFrame(std::vector<glm::vec2>& positions, Trajectory::FrameHeader& frame)
+{
+	if (!m_file || std::fread(&frame, sizeof(frame), 1u, m_file) != 1u)
+	{
+		return false;
+	}
+
+	m_payload.resize(frame.payloadSize);
+	if (frame.payloadSize > 0u && std::fread(&m_payload[0], 1u, m_payload.size(), m_file) != m_payload.size())
+	{
+		return false;
+	}
+
+	const size_t valueCount = (static_cast<size_t>(frame.particleCount) + frame.ballCount + frame.clothCount) * 2u;
+	const size_t referenceCount = (frame.flags & Trajectory::FrameHeader::keyframe) ? 0u : m_previous.size();
+	m_previous.resize(valueCount);
+
+	size_t byte = 0u;
+	size_t value = 0u;
+	while (value < valueCount && byte < m_payload.size())
+	{
+		uint64_t token = 0u;
+		for (int shift = 0; byte < m_payload.size() && shift < 64; shift += 7)
+		{
+			const uint8_t next = m_payload[byte++];
+			token |= static_cast<uint64_t>(next & 0x7Fu) << shift;
+			if ((next & 0x80u) == 0u)
+			{
+				break;
+			}
+		}
+
+		//A zero run repeats the reference values, anything past the previous frame counts against zero
+		const size_t run = (token & 1u) ? static_cast<size_t>(token >> 1) + 1u : 1u;
+		const int64_t delta = (token & 1u) ? 0 : UnZigZag(token >> 1);
+		for (size_t end = std::min(value + run, valueCount); value < end; ++value)
+		{
+			const int64_t reference = value < referenceCount ? m_previous[value] : 0;
+			m_previous[value] = static_cast<int32_t>(reference + delta);
+		}
+	}
+
+	if (value != valueCount || byte != m_payload.size())
+	{
+		return false;
+	}
+
+	positions.resize(valueCount / 2u);
+	for (size_t i = 0u; i < positions.size(); ++i)
+	{
+		positions[i] = glm::vec2(static_cast<float>(m_previous[i * 2u]), static_cast<float>(m_previous[i * 2u + 1u])) * m_header.quantization;
+	}
+	return true;
+}
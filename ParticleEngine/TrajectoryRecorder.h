@@ -0,0 +1,136 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include "Config.hpp"
+
+class ParticleEngine;
+
+//File layout shared by TrajectoryRecorder and TrajectoryReader.
+//A file header is followed by one record per step: a frame header and its encoded positions.
+//Positions are rounded to multiples of the quantization step and stored as the difference to the same value of the
+//previous frame, keyframes against zero. Every difference is zigzag mapped and written as a varint shifted left by one,
+//runs of zero differences, resting and sleeping bodies, collapse into one varint with the low bit set.
+namespace Trajectory
+{
+	const static uint32_t magic = 0x4A525450u; //"PTRJ" read as little endian
+	const static uint32_t version = 1u;
+
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		float quantization;
+		uint32_t keyframeInterval;
+	};
+
+	struct FrameHeader
+	{
+		const static uint32_t keyframe = 1u << 0;
+
+		uint32_t payloadSize;
+		uint32_t flags;
+		uint32_t particleCount;
+		uint32_t particleHead; //Particles are stored by slot, this is the oldest one, see ParticleStore::Head
+		uint32_t ballCount;
+		uint32_t clothCount;
+	};
+}
+
+//Records the particle, ball and cloth positions of every step without stalling the simulation.
+//Record only copies the positions into a staging frame; quantizing, encoding and writing happen on a writer thread.
+//Staging frames come from a fixed pool, if the writer falls that far behind Record waits for it.
+class TrajectoryRecorder
+{
+public:
+	//quantization is the position resolution in pixels, queueDepth the frames that may wait for the writer
+	explicit TrajectoryRecorder(float quantization = Config::recordQuantization, size_t queueDepth = Config::recordQueueDepth, size_t keyframeInterval = Config::recordKeyframeInterval);
+	~TrajectoryRecorder();
+
+	bool Open(const char* path);
+	void Record(const ParticleEngine& engine);
+	//Writes every queued frame and closes the file, false if any write failed
+	bool Close();
+
+	size_t GetFramesRecorded() const { return m_framesRecorded; }
+	//Times Record had to wait for a free staging frame
+	size_t GetStallCount() const { return m_stalls; }
+	uint64_t GetBytesWritten() const { return m_bytesWritten.load(); }
+	//Bytes the positions would have taken as plain floats
+	uint64_t GetRawBytes() const { return m_rawBytes; }
+
+private:
+	struct Frame
+	{
+		std::vector<glm::vec2> positions; //Particles, then balls, then cloth
+		uint32_t particleCount;
+		uint32_t particleHead;
+		uint32_t ballCount;
+		uint32_t clothCount;
+	};
+
+	TrajectoryRecorder(const TrajectoryRecorder& other);
+	TrajectoryRecorder& operator=(const TrajectoryRecorder& other);
+
+	void WriterLoop();
+	void Encode(const Frame& frame, bool keyframe);
+	void PutVarint(uint64_t value);
+
+	float m_quantization;
+	size_t m_keyframeInterval;
+	FILE* m_file;
+
+	//Staging frames cycle from m_free through m_pending to the writer and back
+	std::vector<std::unique_ptr<Frame>> m_frames;
+	std::deque<Frame*> m_free;
+	std::deque<Frame*> m_pending;
+	std::mutex m_mutex;
+	std::condition_variable m_frameFreed;
+	std::condition_variable m_framePending;
+	bool m_running;
+	std::thread m_writer;
+
+	//Writer thread only
+	std::vector<int32_t> m_previous;
+	std::vector<int32_t> m_current;
+	std::vector<uint8_t> m_encoded;
+	size_t m_framesWritten;
+
+	size_t m_framesRecorded;
+	size_t m_stalls;
+	uint64_t m_rawBytes;
+	std::atomic<uint64_t> m_bytesWritten;
+	std::atomic<bool> m_writeFailed;
+};
+
+//Sequential decoder for files written by TrajectoryRecorder
+class TrajectoryReader
+{
+public:
+	TrajectoryReader();
+	~TrajectoryReader();
+
+	bool Open(const char* path);
+	void Close();
+
+	//Decodes the next frame into positions, particles then balls then cloth. False at the end of the file or on a damaged frame.
+	bool ReadFrame(std::vector<glm::vec2>& positions, Trajectory::FrameHeader& frame);
+
+	float GetQuantization() const { return m_header.quantization; }
+
+private:
+	TrajectoryReader(const TrajectoryReader& other);
+	TrajectoryReader& operator=(const TrajectoryReader& other);
+
+	FILE* m_file;
+	Trajectory::FileHeader m_header;
+	std::vector<uint8_t> m_payload;
+	std::vector<int32_t> m_previous;
+};
@@ -1,46 +1,73 @@
 #include <SFML/Graphics.hpp>
 #include "ParticleEngine.h"
+#include "ParticleRenderer.h"
 #include "Config.hpp"
-#include "StaticXORShift.hpp"
+#include "Profiler.h"
+#include <cstdio>
+#include <chrono>
+#include <string>
 
-void main()
+//Usage: ParticleEngine [scene file], without one the default scene is loaded
+int main(int argc, char** argv)
 {
-	StaticXorShift::x = static_cast<unsigned long>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+	SceneDescription scene = argc > 1 ? SceneDescription() : SceneDescription::Default();
+	std::string sceneError;
+	if (argc > 1 && !SceneFile::Load(argv[1], scene, &sceneError))
+	{
+		std::fprintf(stderr, "Could not load %s: %s\n", argv[1], sceneError.c_str());
+		return 1;
+	}
 
 	sf::ContextSettings settings;
 	settings.majorVersion = 4;
 	settings.minorVersion = 4;
 	settings.antialiasingLevel = 8;
 
-	StaticXorShift::y = static_cast<unsigned long>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
-
 	sf::RenderWindow window(sf::VideoMode(Config::width, Config::height), "Particle Engine", sf::Style::Default, settings);
 	window.setVerticalSyncEnabled(Config::useVsync);
 	window.setFramerateLimit(60u);
 
-	StaticXorShift::z = static_cast<unsigned long>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+	Profiler::SetEnabled(Config::enableProfiler);
+	Profiler::FrameHistogram frameTimes;
 
 	sf::Clock frameTimer;
-	float fpsDisplayDelay = 0.0f;
-	float physicsUpdateCooldown = 0.0f;
-	ParticleEngine engine;
+	float statsDisplayDelay = 0.0f;
+	float statsWindow = 0.0f;
+	float renderAlpha = 1.0f;
+	ParticleEngine engine(scene);
+	ParticleRenderer renderer;
+	//A scene file keeps its own seed so it replays the same way
+	if (argc <= 1)
+	{
+		engine.SeedRandom(static_cast<uint64_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count()));
+	}
 
 	while (window.isOpen())
 	{
 		//GPU Kick
 		window.clear();
-		engine.Render(window);
+		renderer.Render(engine, window, renderAlpha);
 
 		float deltaTime = frameTimer.restart().asSeconds(); 
-		fpsDisplayDelay += deltaTime;
+		statsDisplayDelay += deltaTime;
+		statsWindow += deltaTime;
+		frameTimes.Add(deltaTime * 1000.0f);
 		deltaTime = std::min(deltaTime, 0.1f);
 
-		//FPS Counter
-		if (fpsDisplayDelay > 0.5f)
+		//Frame time percentiles over the last few seconds, a single slow frame shows up in p99
+		if (statsDisplayDelay > 0.5f)
+		{
+			char title[160];
+			std::snprintf(title, sizeof(title), "Particle Engine p50: %.2fms p95: %.2fms p99: %.2fms draws: %zu",
+				frameTimes.GetPercentile(0.5f), frameTimes.GetPercentile(0.95f), frameTimes.GetPercentile(0.99f), renderer.GetDrawCalls());
+			window.setTitle(title);
+			statsDisplayDelay = 0.0f;
+		}
+
+		if (statsWindow > Config::frameStatsWindow)
 		{
-			int fps = static_cast<int>(1.0f / deltaTime);
-			window.setTitle("Particle Engine FPS: " + std::to_string(fps));
-			fpsDisplayDelay = 0.0f;
+			frameTimes.Reset();
+			statsWindow = 0.0f;
 		}
 
 		sf::Event event;
@@ -58,24 +85,29 @@ void main()
 				{
 					window.close();
 				}
+				//Dumps the recent phase timings of every thread
+				if (event.key.code == sf::Keyboard::Key::F12)
+				{
+					Profiler::WriteChromeTrace("trace.json");
+				}
 			}
 			if (event.type == sf::Event::MouseButtonPressed)
 			{
-				engine.GetInput(event.mouseButton);
+				if (event.mouseButton.button == sf::Mouse::Button::Left)
+				{
+					engine.SpawnBall(glm::vec2((float)event.mouseButton.x, (float)event.mouseButton.y));
+				}
 			}
 		}
 
 		if(Config::useFixedUpdate)
 		{
-			physicsUpdateCooldown -= deltaTime;
-			if (physicsUpdateCooldown <= 0.0f)
-			{
-				physicsUpdateCooldown = Config::fixedPhysicsUpdate;
-				engine.Update(Config::fixedPhysicsUpdate);
-			}
+			engine.Advance(deltaTime, Config::fixedPhysicsUpdate, Config::maxSubsteps);
+			renderAlpha = engine.GetInterpolationAlpha();
 		} else
 		{
 			engine.Update(deltaTime);
+			renderAlpha = 1.0f;
 		}
 		
 		
@@ -84,4 +116,6 @@ void main()
 		//Display
 		window.display();
 	}
+
+	return 0;
 }